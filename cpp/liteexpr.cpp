@@ -1,8 +1,22 @@
 #include <codecvt>
+#include <charconv>
+#include <algorithm>
+#include <cctype>
+#include <cfloat>
 #include <cstdio>
+#include <cstring>
 #include <cmath>
+#include <list>
 #include <memory>
+#include <mutex>
 #include <utility>
+#include <unordered_map>
+#include <unordered_set>
+#include <fstream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 #include "liteexpr.h"
 
 namespace liteexpr {
@@ -13,44 +27,299 @@ namespace liteexpr {
     int64_t MAXARGS = std::numeric_limits<int>::max();
     int64_t MAXINT = std::numeric_limits<int64_t>::max();
     int64_t MININT = std::numeric_limits<int64_t>::min();
+
+    static VALUE builtin_closure(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor, SYMBOLS upscope);
+    static bool is_builtin(VALUE value, const string& name);
+}
+
+namespace liteexpr {
+    /* ***************************************************************************
+    * MEMORY
+    */
+
+    /*
+    * Memory used by the evaluation running on this thread.  Values charge
+    * their own size and the storage they own as it grows to the meter that
+    * is current, and refund it when freed to the meter they charged, if that
+    * evaluation is still running.
+    */
+    class Meter {
+        Usage* usage;
+
+        public:
+            Meter* outer;
+            uint64_t serial;
+            int64_t limit;
+            int64_t current;
+            int64_t peak;
+
+            Meter(const Limits& limits);
+            ~Meter();
+    };
+
+    static thread_local Meter* meter = nullptr;
+    static std::atomic<uint64_t> meters(0);
+
+    /* shared_ptr keeps its counts in a block allocated beside the value */
+    static const int64_t CONTROL_BYTES = 3 * sizeof(void*);
+
+    /* Allocations made by values begin with the serial of the meter charged */
+    static const size_t METER_HEADER = alignof(std::max_align_t);
+
+    Meter::Meter(const Limits& limits) {
+        this->outer = meter;
+        this->serial = ++meters;
+        this->limit = limits.memory;
+        this->usage = limits.usage;
+        this->current = 0;
+        this->peak = 0;
+
+        meter = this;
+    }
+
+    Meter::~Meter() {
+        meter = this->outer;
+
+        if(this->usage) {
+            this->usage->current = this->current;
+            this->usage->peak = this->peak;
+        }
+    }
+
+    static void charge(int64_t bytes) {
+        if(!meter) return;
+
+        if(meter->limit && bytes > 0 && meter->current + bytes > meter->limit) {
+            throw MemoryError("Memory limit of " + to_string(meter->limit) + " bytes exceeded");
+        }
+
+        meter->current += bytes;
+        if(meter->peak < meter->current) meter->peak = meter->current;
+    }
+
+    static void refund(uint64_t serial, int64_t bytes) {
+        for(Meter* m = meter; m && serial; m = m->outer) {
+            if(m->serial == serial) {
+                m->current -= bytes;
+                break;
+            }
+        }
+    }
+
+    /* Charge storage to the current meter.  Bytes charged to an earlier
+    * meter are left with it. */
+    static void charge(Charge& charged, int64_t bytes) {
+        uint64_t serial = meter ? meter->serial : 0;
+
+        if(charged.meter != serial) charged = Charge{ serial, 0 };
+
+        charge(bytes);
+        charged.bytes += bytes;
+    }
+
+    static void refund(Charge& charged, int64_t bytes) {
+        bytes = std::min(bytes, charged.bytes);
+
+        refund(charged.meter, bytes);
+        charged.bytes -= bytes;
+    }
+
+    /* Bytes a string holds outside itself */
+    static int64_t heap_bytes(const string& s) {
+        static const size_t local = string().capacity();
+
+        return s.capacity() > local ? s.capacity() + 1 : 0;
+    }
+
+    /* Bytes of one entry of a map<string,T>: the tree node and its key */
+    template<typename T> static int64_t node_bytes(const string& k) {
+        return sizeof(pair<const string,T>) + 4 * sizeof(void*) + heap_bytes(k);
+    }
+
+    /*
+    * Allocates a value and its reference counts in a single block, charged
+    * to the meter like any other value.
+    */
+    template<typename T> class MeteredAllocator {
+        public:
+            typedef T value_type;
+
+            MeteredAllocator() {}
+            template<typename U> MeteredAllocator(const MeteredAllocator<U>&) {}
+
+            T* allocate(size_t n) {
+                charge(n * sizeof(T));
+
+                char* block = static_cast<char*>(::operator new(METER_HEADER + n * sizeof(T)));
+
+                *reinterpret_cast<uint64_t*>(block) = meter ? meter->serial : 0;
+
+                return reinterpret_cast<T*>(block + METER_HEADER);
+            }
+
+            void deallocate(T* p, size_t n) {
+                char* block = reinterpret_cast<char*>(p) - METER_HEADER;
+
+                refund(*reinterpret_cast<uint64_t*>(block), n * sizeof(T));
+
+                ::operator delete(block);
+            }
+
+            template<typename U> bool operator==(const MeteredAllocator<U>&) const { return true; }
+            template<typename U> bool operator!=(const MeteredAllocator<U>&) const { return false; }
+    };
+
+    template<typename T, typename... Args> static VALUE make(Args&&... args) {
+        return std::allocate_shared<T>(MeteredAllocator<T>(), std::forward<Args>(args)...);
+    }
+
+    void* Value::operator new(size_t size) {
+        charge(size + CONTROL_BYTES);
+
+        char* block = static_cast<char*>(::operator new(METER_HEADER + size));
+
+        *reinterpret_cast<uint64_t*>(block) = meter ? meter->serial : 0;
+
+        return block + METER_HEADER;
+    }
+
+    void Value::operator delete(void* p, size_t size) {
+        char* block = static_cast<char*>(p) - METER_HEADER;
+
+        refund(*reinterpret_cast<uint64_t*>(block), size + CONTROL_BYTES);
+
+        ::operator delete(block);
+    }
 }
 
 namespace liteexpr {
+    /* ***************************************************************************
+    * WRITER
+    */
+
+    /* Bytes held before they are passed on to a stream */
+    static const size_t WRITER_CHUNK = 64 * 1024;
+
+    Writer::Writer(std::ostream& out, Format format) {
+        this->out = &out;
+        this->buffer = &this->chunk;
+        this->pretty = (format == Format::PRETTY);
+        this->depth = 0;
+    }
+
+    Writer::Writer(string& buffer, Format format) {
+        this->out = nullptr;
+        this->buffer = &buffer;
+        this->pretty = (format == Format::PRETTY);
+        this->depth = 0;
+    }
+
+    Writer::~Writer() {
+        this->flush();
+    }
+
+    bool Writer::isPretty() const {
+        return this->pretty;
+    }
+
+    void Writer::put(char c) {
+        this->put(&c, 1);
+    }
+
+    /* Lines after the first are indented to the current depth */
+    void Writer::put(const char* text, size_t size) {
+        const char* end = text + size;
+
+        while(this->pretty && this->depth && text < end) {
+            const char* eol = static_cast<const char*>(std::memchr(text, '\n', end - text));
+
+            if(!eol) break;
+
+            this->buffer->append(text, eol - text);
+            this->newline();
+            text = eol + 1;
+        }
+
+        this->buffer->append(text, end - text);
+
+        if(this->out && this->chunk.size() >= WRITER_CHUNK) this->flush();
+    }
+
+    void Writer::put(const string& text) {
+        this->put(text.data(), text.size());
+    }
+
+    void Writer::indent() {
+        this->depth++;
+    }
+
+    void Writer::dedent() {
+        this->depth--;
+    }
+
+    /* Start a new line in pretty output; nothing in compact output */
+    void Writer::newline() {
+        if(!this->pretty) return;
+
+        this->buffer->push_back('\n');
+        this->buffer->append(2 * this->depth, ' ');
+    }
+
+    void Writer::flush() {
+        if(!this->out) return;
+
+        this->out->write(this->chunk.data(), this->chunk.size());
+        this->chunk.clear();
+    }
+
+
     /* ***************************************************************************
     * VALUE
     */
 
-    bool Value::istrue() const { throw BasicRuntimeError("Unsupported operation `istrue()`: " + this->name()); }
-    int64_t Value::length() const { throw BasicRuntimeError("Unsupported operation `length()`: " + this->name()); }
-    int64_t Value::ivalue() const { throw BasicRuntimeError("Unsupported operation `ivalue()`: " + this->name()); }
-    double Value::dvalue() const { throw BasicRuntimeError("Unsupported operation `dvalue()`: " + this->name()); }
-    string Value::svalue() const { throw BasicRuntimeError("Unsupported operation `svalue()`: " + this->name()); }
-    const vector<VALUE>& Value::avalue() const { throw BasicRuntimeError("Unsupported operation `avalue()`: " + this->name()); }
-    const map<string,VALUE>& Value::ovalue() const { throw BasicRuntimeError("Unsupported operation `ovalue()`: " + this->name()); }
+    /* Values without a writer of their own write what encoded() returns */
+    void Value::write(Writer& out) const {
+        out.put(this->encoded());
+    }
+
+    bool Value::istrue() const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERATION, "istrue()", this->name()); }
+    int64_t Value::length() const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERATION, "length()", this->name()); }
+    int64_t Value::ivalue() const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERATION, "ivalue()", this->name()); }
+    double Value::dvalue() const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERATION, "dvalue()", this->name()); }
+    string Value::svalue() const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERATION, "svalue()", this->name()); }
+    const vector<VALUE>& Value::avalue() const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERATION, "avalue()", this->name()); }
+    const map<string,VALUE>& Value::ovalue() const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERATION, "ovalue()", this->name()); }
     VALUE Value::op_not() const { return VALUE(new Integer(this->istrue() ? 0 : 1)); }
-    VALUE Value::op_inv() const { throw BasicRuntimeError("Unsupported operand type for `~`: (" + this->name() + ")"); }
-    VALUE Value::op_pos() const { throw BasicRuntimeError("Unsupported operand type for `+`: (" + this->name() + ")"); }
-    VALUE Value::op_neg() const { throw BasicRuntimeError("Unsupported operand type for `-`: (" + this->name() + ")"); }
-    VALUE Value::op_inc() const { throw BasicRuntimeError("Unsupported operand type for `++`: (" + this->name() + ")"); }
-    VALUE Value::op_dec() const { throw BasicRuntimeError("Unsupported operand type for `--`: (" + this->name() + ")"); }
-    VALUE Value::op_lt(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `<`: (" + this->name() + ",*)"); }
-    VALUE Value::op_gt(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `>`: (" + this->name() + ",*)"); }
-    VALUE Value::op_eq(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `==`: (" + this->name() + ",*)"); }
-    VALUE Value::op_ne(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `!=`: (" + this->name() + ",*)"); }
-    VALUE Value::op_lte(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `<=`: (" + this->name() + ",*)"); }
-    VALUE Value::op_gte(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `>=`: (" + this->name() + ",*)"); }
-    VALUE Value::op_pow(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `**`: (" + this->name() + ",*)"); }
-    VALUE Value::op_mul(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `*`: (" + this->name() + ",*)"); }
-    VALUE Value::op_div(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `/`: (" + this->name() + ",*)"); }
-    VALUE Value::op_add(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `+`: (" + this->name() + ",*)"); }
-    VALUE Value::op_sub(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `-`: (" + this->name() + ",*)"); }
-    VALUE Value::op_mod(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `%`: (" + this->name() + ",*)"); }
-    VALUE Value::op_shl(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `<<`: (" + this->name() + ",*)"); }
-    VALUE Value::op_asr(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `>>`: (" + this->name() + ",*)"); }
-    VALUE Value::op_shr(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `>>>`: (" + this->name() + ",*)"); }
-    VALUE Value::op_and(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `&`: (" + this->name() + ",*)"); }
-    VALUE Value::op_xor(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `^`: (" + this->name() + ",*)"); }
-    VALUE Value::op_or(const VALUE other) const { throw BasicRuntimeError("Unsupported operand type(s) for `|`: (" + this->name() + ",*)"); }
+    VALUE Value::op_inv() const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERAND, "~", this->name()); }
+    VALUE Value::op_pos() const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERAND, "+", this->name()); }
+    VALUE Value::op_neg() const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERAND, "-", this->name()); }
+    VALUE Value::op_inc() const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERAND, "++", this->name()); }
+    VALUE Value::op_dec() const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERAND, "--", this->name()); }
+    VALUE Value::op_lt(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "<", this->name()); }
+    VALUE Value::op_gt(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">", this->name()); }
+    VALUE Value::op_eq(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "==", this->name()); }
+    VALUE Value::op_ne(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "!=", this->name()); }
+    VALUE Value::op_lte(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "<=", this->name()); }
+    VALUE Value::op_gte(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">=", this->name()); }
+    VALUE Value::op_pow(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "**", this->name()); }
+    VALUE Value::op_mul(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "*", this->name()); }
+    VALUE Value::op_div(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "/", this->name()); }
+    VALUE Value::op_add(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "+", this->name()); }
+    VALUE Value::op_sub(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "-", this->name()); }
+    VALUE Value::op_mod(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "%", this->name()); }
+    VALUE Value::op_shl(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "<<", this->name()); }
+    VALUE Value::op_asr(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">>", this->name()); }
+    VALUE Value::op_shr(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">>>", this->name()); }
+    VALUE Value::op_and(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "&", this->name()); }
+    VALUE Value::op_xor(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "^", this->name()); }
+    VALUE Value::op_or(const VALUE other) const { throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "|", this->name()); }
+
+    /* The value an identifier refers to, rather than the identifier */
+    static VALUE resolved(VALUE value) {
+        while(IDENT ident = dynamic_pointer_cast<Ident>(value)) value = ident->get();
+
+        return value;
+    }
 
     /* ***************************************************************************
     * INTEGER
@@ -68,6 +337,13 @@ namespace liteexpr {
         return to_string(decoded);
     }
 
+    void Integer::write(Writer& out) const {
+        char buffer[24];
+        auto end = std::to_chars(buffer, buffer + sizeof(buffer), this->value).ptr;
+
+        out.put(buffer, end - buffer);
+    }
+
     int64_t Integer::decode(const string& encoded) {
         int64_t decoded = 0;
 
@@ -147,21 +423,21 @@ namespace liteexpr {
     VALUE Integer::op_inv() const { return VALUE(new Integer(~this->value)); }
     VALUE Integer::op_pos() const { return VALUE(new Integer(this->value)); }
     VALUE Integer::op_neg() const { return VALUE(new Integer(-this->value)); }
-    VALUE Integer::op_inc() const { return VALUE(new Integer(this->value + 1)); }
-    VALUE Integer::op_dec() const { return VALUE(new Integer(this->value - 1)); }
+    VALUE Integer::op_inc() const { return VALUE(new Integer(static_cast<int64_t>(static_cast<uint64_t>(this->value) + 1))); }
+    VALUE Integer::op_dec() const { return VALUE(new Integer(static_cast<int64_t>(static_cast<uint64_t>(this->value) - 1))); }
 
     VALUE Integer::op_lt(VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value < other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Integer(this->value < other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `<`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "<", this->name(), other->name());
     }
 
     VALUE Integer::op_gt(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value > other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Integer(this->value > other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `>`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">", this->name(), other->name());
     }
 
     VALUE Integer::op_eq(const VALUE other) const {
@@ -182,14 +458,14 @@ namespace liteexpr {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value <= other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Integer(this->value <= other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `<=`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "<=", this->name(), other->name());
     }
 
     VALUE Integer::op_gte(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value >= other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Integer(this->value >= other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `>=`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">=", this->name(), other->name());
     }
 
     VALUE Integer::op_pow(const VALUE other) const {
@@ -206,14 +482,14 @@ namespace liteexpr {
             return VALUE(new Double(pow(this->value, other->dvalue())));
         }
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `**`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "**", this->name(), other->name());
     }
 
     VALUE Integer::op_mul(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value * other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Double(this->value * other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `*`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "*", this->name(), other->name());
     }
 
     VALUE Integer::op_div(const VALUE other) const {
@@ -221,12 +497,12 @@ namespace liteexpr {
         if(other->type() == typeid(Integer)) {
             int64_t ov = other->ivalue();
 
-            if(ov == 0) throw BasicRuntimeError("Division by zero: (" + this->svalue() + " / " + other->svalue() + ")");
+            if(ov == 0) throw BasicRuntimeError(ErrorCode::DIVISION_BY_ZERO, "/", this->svalue(), other->svalue());
 
             return VALUE(new Integer(this->value / other->ivalue()));
         }
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `/`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "/", this->name(), other->name());
     }
 
     VALUE Integer::op_add(const VALUE other) const {
@@ -234,38 +510,38 @@ namespace liteexpr {
         if(other->type() == typeid(Double))  return VALUE(new Double(this->value + other->dvalue()));
         if(other->type() == typeid(String))  return VALUE(new String(this->svalue() + other->svalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `+`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "+", this->name(), other->name());
     }
 
     VALUE Integer::op_sub(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value - other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Double(this->value - other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `-`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "-", this->name(), other->name());
     }
 
     VALUE Integer::op_mod(const VALUE other) const {
         if(other->type() == typeid(Integer)) {
             int64_t ov = other->ivalue();
 
-            if(ov == 0) throw BasicRuntimeError("Modulus by zero: (" + this->svalue() + " % " + other->svalue() + ")");
+            if(ov == 0) throw BasicRuntimeError(ErrorCode::MODULUS_BY_ZERO, "%", this->svalue(), other->svalue());
 
             return VALUE(new Integer(this->value % other->ivalue()));
         }
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `%`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "%", this->name(), other->name());
     }
 
     VALUE Integer::op_shl(const VALUE other) const {
         if(other->type() == typeid(Integer)) {
             int64_t ov = other->ivalue();
 
-            if(ov < 0) throw BasicRuntimeError("Invalid attempt to shift `<<` by a negative amount: " + other->svalue());
+            if(ov < 0) throw BasicRuntimeError(ErrorCode::NEGATIVE_SHIFT, "<<", "", other->svalue());
 
             return VALUE(new Integer(this->value << other->ivalue()));
         }
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `<<`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "<<", this->name(), other->name());
     }
 
     VALUE Integer::op_asr(const VALUE other) const {
@@ -274,7 +550,7 @@ namespace liteexpr {
             int64_t shiftby = other->ivalue();
 
             if(shiftby < 0) {
-                throw BasicRuntimeError("Invalid attempt to shift `>>` by a negative amount: " + other->svalue());
+                throw BasicRuntimeError(ErrorCode::NEGATIVE_SHIFT, ">>", "", other->svalue());
             }
             else if(shiftby < 64 && value < 0) {
                 value = ~value;
@@ -291,7 +567,7 @@ namespace liteexpr {
             return VALUE(new Integer(value));
         }
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `>>`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">>", this->name(), other->name());
     }
 
     VALUE Integer::op_shr(const VALUE other) const {
@@ -300,7 +576,7 @@ namespace liteexpr {
             int64_t shiftby = other->ivalue();
 
             if(shiftby < 0) {
-                throw BasicRuntimeError("Invalid attempt to shift `>>>` by a negative amount: " + other->svalue());
+                throw BasicRuntimeError(ErrorCode::NEGATIVE_SHIFT, ">>>", "", other->svalue());
             }
             else if(shiftby < 64 && value < 0) {
                 value ^= INT64_C(0x8000000000000000);
@@ -317,25 +593,25 @@ namespace liteexpr {
             return VALUE(new Integer(value));
         }
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `>>>`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">>>", this->name(), other->name());
     }
 
     VALUE Integer::op_and(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value & other->ivalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `&`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "&", this->name(), other->name());
     }
 
     VALUE Integer::op_xor(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value ^ other->ivalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `^`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "^", this->name(), other->name());
     }
 
     VALUE Integer::op_or(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value | other->ivalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `|`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "|", this->name(), other->name());
     }
 
 
@@ -352,21 +628,18 @@ namespace liteexpr {
     }
 
     string Double::encode(double decoded) {
-        string result = to_string(decoded);
-        size_t dpos = result.find(".");
+        if     (std::isinf( decoded) && decoded > 0) return "Inf";
+        else if(std::isinf(-decoded) && decoded < 0) return "-Inf";
+        else if(std::isnan( decoded)) return "NaN";
 
-        if     (std::isinf( decoded) && decoded > 0) result = "Inf";
-        else if(std::isinf(-decoded) && decoded < 0) result = "-Inf";
-        else if(std::isnan( decoded)) result = "NaN";
-        else if(dpos < result.length()-2 && result.find("e") == string::npos) {
-            size_t i = result.length();
+        /* Six decimals, as printf("%f") would, less trailing zeros */
+        char buffer[DBL_MAX_10_EXP + 16];
+        char* end = std::to_chars(buffer, buffer + sizeof(buffer), decoded, std::chars_format::fixed, 6).ptr;
+        char* dot = std::find(buffer, end, '.');
 
-            /* Remove trailing zeros */
-            while(result[i-1] == '0' && dpos < i-2) i--;
-            result = result.substr(0,i);
-        }
+        while(end - dot > 2 && end[-1] == '0') end--;
 
-        return result;
+        return string(buffer, end);
     }
 
     double Double::decode(const string& encoded) {
@@ -381,6 +654,10 @@ namespace liteexpr {
         return this->encode(this->value);
     }
 
+    void Double::write(Writer& out) const {
+        out.put(this->encode(this->value));
+    }
+
     const type_info& Double::type() const {
         return typeid(*this);
     }
@@ -396,14 +673,14 @@ namespace liteexpr {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value < other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Integer(this->value < other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `<`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "<", this->name(), other->name());
     }
 
     VALUE Double::op_gt(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value > other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Integer(this->value > other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `>`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">", this->name(), other->name());
     }
 
     VALUE Double::op_eq(const VALUE other) const {
@@ -424,35 +701,35 @@ namespace liteexpr {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value <= other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Integer(this->value <= other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `<=`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "<=", this->name(), other->name());
     }
 
     VALUE Double::op_gte(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Integer(this->value >= other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Integer(this->value >= other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `>=`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">=", this->name(), other->name());
     }
 
     VALUE Double::op_pow(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Double(std::pow(this->value, other->ivalue())));
         if(other->type() == typeid(Double)) return VALUE(new Double(std::pow(this->value, other->dvalue())));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `**`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "**", this->name(), other->name());
     }
 
     VALUE Double::op_mul(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Double(this->value * other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Double(this->value * other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `*`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "*", this->name(), other->name());
     }
 
     VALUE Double::op_div(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Double(this->value / other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Double(this->value / other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `/`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "/", this->name(), other->name());
     }
 
     VALUE Double::op_add(const VALUE other) const {
@@ -460,14 +737,14 @@ namespace liteexpr {
         if(other->type() == typeid(Double))  return VALUE(new Double(this->value + other->dvalue()));
         if(other->type() == typeid(String))  return VALUE(new String(this->svalue() + other->svalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `+`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "+", this->name(), other->name());
     }
 
     VALUE Double::op_sub(const VALUE other) const {
         if(other->type() == typeid(Integer)) return VALUE(new Double(this->value - other->ivalue()));
         if(other->type() == typeid(Double)) return VALUE(new Double(this->value - other->dvalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `-`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "-", this->name(), other->name());
     }
 
 
@@ -477,6 +754,12 @@ namespace liteexpr {
 
     String::String(const string& v) {
         this->value = v;
+
+        charge(this->charged, heap_bytes(this->value));
+    }
+
+    String::~String() {
+        refund(this->charged, this->charged.bytes);
     }
 
     const string& String::native() const {
@@ -484,24 +767,39 @@ namespace liteexpr {
     }
 
     string String::encode(const string& decoded) {
-        string encoded = "\"";
+        string encoded;
+        Writer out(encoded);
 
-        for(int i=0; i<decoded.length(); i++) {
-            const char c = decoded[i];
+        encode(out, decoded);
 
-            switch(c) {
-                case '\\' : encoded += "\\\\"; break;
-                case '"'  : encoded += "\\\""; break;
-                case '\r' : encoded += "\\r"; break;
-                case '\n' : encoded += "\\n"; break;
-                case '\t' : encoded += "\\t"; break;
-                default   : encoded += c; break;
+        return encoded;
+    }
+
+    void String::encode(Writer& out, const string& decoded) {
+        size_t run = 0;
+
+        out.put('"');
+
+        /* Copy runs of plain characters whole */
+        for(size_t i=0; i<decoded.length(); i++) {
+            const char* escaped;
+
+            switch(decoded[i]) {
+                case '\\' : escaped = "\\\\"; break;
+                case '"'  : escaped = "\\\""; break;
+                case '\r' : escaped = "\\r"; break;
+                case '\n' : escaped = "\\n"; break;
+                case '\t' : escaped = "\\t"; break;
+                default   : continue;
             }
-        }
 
-        encoded += "\"";
+            out.put(decoded.data() + run, i - run);
+            out.put(escaped, 2);
+            run = i + 1;
+        }
 
-        return encoded;
+        out.put(decoded.data() + run, decoded.length() - run);
+        out.put('"');
     }
 
     string String::decode(const string& encoded0) {
@@ -562,6 +860,10 @@ namespace liteexpr {
         return this->encode(this->value);
     }
 
+    void String::write(Writer& out) const {
+        encode(out, this->value);
+    }
+
     const type_info& String::type() const {
         return typeid(*this);
     }
@@ -581,13 +883,13 @@ namespace liteexpr {
     VALUE String::op_lt(const VALUE other) const {
         if(other->type() == typeid(String)) return VALUE(new Integer(this->value < other->svalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `<`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "<", this->name(), other->name());
     }
 
     VALUE String::op_gt(const VALUE other) const {
         if(other->type() == typeid(String)) return VALUE(new Integer(this->value > other->svalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `>`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">", this->name(), other->name());
     }
 
     VALUE String::op_eq(const VALUE other) const {
@@ -605,13 +907,13 @@ namespace liteexpr {
     VALUE String::op_lte(const VALUE other) const {
         if(other->type() == typeid(String)) return VALUE(new Integer(this->value <= other->svalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `<=`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "<=", this->name(), other->name());
     }
 
     VALUE String::op_gte(const VALUE other) const {
         if(other->type() == typeid(String)) return VALUE(new Integer(this->value >= other->svalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `>=`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">=", this->name(), other->name());
     }
 
     VALUE String::op_add(const VALUE other) const {
@@ -619,7 +921,7 @@ namespace liteexpr {
         if(other->type() == typeid(Integer)) return VALUE(new String(this->value + other->svalue()));
         if(other->type() == typeid(Double))  return VALUE(new String(this->value + other->svalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `+`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "+", this->name(), other->name());
     }
 
 
@@ -628,11 +930,31 @@ namespace liteexpr {
     */
 
     Array::Array() {
-        /* Intentionally left blank */
     }
 
     Array::Array(const vector<VALUE>& v) {
         this->value = v;
+        this->account();
+    }
+
+    Array::Array(vector<VALUE>&& v) {
+        this->value = std::move(v);
+        this->account();
+    }
+
+    Array::~Array() {
+        refund(this->charged, this->charged.bytes);
+    }
+
+    /* Charge for the storage as it grows.  Growing moves the elements to
+    * new storage, which is charged to the current meter. */
+    void Array::account() {
+        int64_t bytes = this->value.capacity() * sizeof(VALUE);
+
+        if(bytes != this->charged.bytes) {
+            refund(this->charged, this->charged.bytes);
+            charge(this->charged, bytes);
+        }
     }
 
     const vector<VALUE>& Array::native() const {
@@ -640,46 +962,63 @@ namespace liteexpr {
     }
 
     string Array::encode(const vector<VALUE>& decoded) {
-        string encoded = "[";
+        string encoded;
+        Writer out(encoded);
+
+        encode(out, decoded);
+
+        return encoded;
+    }
 
-        for(int i=0; i<decoded.size(); i++) {
-            vector<string> childLines = String::split(decoded[i]->encoded(), "\n");
+    void Array::encode(Writer& out, const vector<VALUE>& decoded) {
+        out.put('[');
+        out.indent();
 
-            if(i) encoded += ",";
+        for(size_t i=0; i<decoded.size(); i++) {
+            if(i) out.put(',');
 
-            for(int j=0; j<childLines.size(); j++) {
-                encoded += "\n  " + childLines[j];
-            }
+            out.newline();
+            decoded[i]->write(out);
         }
 
-        encoded += "\n]";
+        out.dedent();
+        out.newline();
+        out.put(']');
+    }
+
+    /* The element at i, or nullptr if i is out of range */
+    VALUE Array::find(int64_t i) const {
+        if(i < 0 || this->value.size() <= i) return nullptr;
 
-        return encoded;
+        return this->value[i];
     }
 
     VALUE Array::get(int64_t i) const {
-        try {
-            return this->value.at(i);
-        }
-        catch(std::out_of_range e) {
-            throw BasicRuntimeError(string("Array index `") + std::to_string(i) + "` out of range, expected < " + std::to_string(this->value.size()));
+        VALUE found = this->find(i);
+
+        if(!found) {
+            throw BasicRuntimeError(ErrorCode::INDEX_OUT_OF_RANGE, "<", std::to_string(i), std::to_string(this->value.size()));
         }
+
+        return found;
     }
 
     void Array::set(int64_t i, VALUE v) {
-        if(this->value.size() < i) {
+        if(0 <= i && i < this->value.size()) {
             this->value[i] = v;
         }
         else if(this->value.size() == i) {
             this->value.push_back(v);
+            this->account();
         }
         else {
-            throw BasicRuntimeError(string("Array index `") + std::to_string(i) + "` out of range, expected <= " + std::to_string(this->value.size()));
+            throw BasicRuntimeError(ErrorCode::INDEX_OUT_OF_RANGE, "<=", std::to_string(i), std::to_string(this->value.size()));
         }
     }
 
     void Array::push(VALUE v) {
         this->value.push_back(v);
+        this->account();
     }
 
     string Array::name() const {
@@ -690,6 +1029,10 @@ namespace liteexpr {
         return this->encode(this->value);
     }
 
+    void Array::write(Writer& out) const {
+        encode(out, this->value);
+    }
+
     const type_info& Array::type() const {
         return typeid(*this);
     }
@@ -713,13 +1056,13 @@ namespace liteexpr {
     VALUE Array::op_lt(const VALUE other) const {
         if(other->type() == typeid(Array)) return VALUE(new Integer(this->value < other->avalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `<`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "<", this->name(), other->name());
     }
 
     VALUE Array::op_gt(const VALUE other) const {
         if(other->type() == typeid(Array)) return VALUE(new Integer(this->value > other->avalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `>`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">", this->name(), other->name());
     }
 
     VALUE Array::op_eq(const VALUE other) const {
@@ -737,13 +1080,13 @@ namespace liteexpr {
     VALUE Array::op_lte(const VALUE other) const {
         if(other->type() == typeid(Array)) return VALUE(new Integer(this->value <= other->avalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `<=`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "<=", this->name(), other->name());
     }
 
     VALUE Array::op_gte(const VALUE other) const {
         if(other->type() == typeid(Array)) return VALUE(new Integer(this->value >= other->avalue()));
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `>=`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, ">=", this->name(), other->name());
     }
 
     VALUE Array::op_add(const VALUE other) const {
@@ -757,841 +1100,5163 @@ namespace liteexpr {
             return VALUE(new Array(sum));
         }
 
-        throw BasicRuntimeError("Unsupported operand type(s) for `+`: (" + this->name() + "," + other->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERANDS, "+", this->name(), other->name());
+    }
+
+    void Array::traverse(vector<Value*>& refs) const {
+        for(const VALUE& v : this->value) refs.push_back(v.get());
+    }
+
+    void Array::clear() {
+        this->value.clear();
     }
 
 
     /* ***************************************************************************
-    * OBJECT
+    * VIEWS
     */
 
-    Object::Object() {
-        /* Intentionally left blank */
-    }
-
-    Object::Object(initializer_list<pair<string,VALUE> > init) {
-        for(auto rec : init) {
-            this->value[rec.first] = rec.second;
-        }
+    ArrayView::ArrayView() {
+        this->copyOnWrite = false;
     }
 
-    Object::Object(const map<string,VALUE>& v) {
-        this->value = v;
+    void ArrayView::setCopyOnWrite(bool enabled) {
+        this->copyOnWrite = enabled;
     }
 
-    const map<string,VALUE>& Object::native() const {
-        return this->value;
+    /* Whether an assignment has copied the view */
+    bool ArrayView::copied() const {
+        return this->copy ? true : false;
     }
 
-    string Object::encode(const map<string,VALUE>& decoded, SYMBOLS parent) {
-        string encoded = "{";
-        int i = 0;
+    /* The element at i, or nullptr if i is out of range */
+    VALUE ArrayView::find(int64_t i) const {
+        if(this->copy) return this->copy->find(i);
+        if(i < 0 || this->size() <= i) return nullptr;
 
-        if(parent) {
-            vector<string> childLines = String::split(parent->encoded(), "\n");
-            encoded += "\n  __PARENT__ : ";
+        return this->element(i);
+    }
 
-            for(int j=0; j<childLines.size(); j++) {
-                if(j) encoded += "\n  ";
-                encoded += childLines[j];
-            }
+    VALUE ArrayView::get(int64_t i) const {
+        VALUE found = this->find(i);
 
-            i++;
+        if(!found) {
+            throw BasicRuntimeError(ErrorCode::INDEX_OUT_OF_RANGE, "<", std::to_string(i), std::to_string(this->length()));
         }
 
-        for(const pair<string,VALUE >& pi: decoded) {
-            string name = pi.first;
-            VALUE value = pi.second;
+        return found;
+    }
 
-            if(i++) encoded += ",";
-            encoded += "\n  " + name + " : ";
+    void ArrayView::set(int64_t i, VALUE v) {
+        if(!this->copy) {
+            vector<VALUE> elements;
 
-            if(pi.first == "GLOBAL" || pi.first == "UPSCOPE") {
-                encoded += string("<") + pi.first + ">";
-            }
-            else {
-                vector<string> childLines = String::split(value->encoded(), "\n");
+            if(!this->copyOnWrite) throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERATION, "=", "read-only " + this->name());
 
-                for(int j=0; j<childLines.size(); j++) {
-                    if(j) encoded += "\n  ";
-                    encoded += childLines[j];
-                }
-            }
+            elements.reserve(this->size());
+            for(int64_t j = 0; j < this->size(); j++) elements.push_back(this->element(j));
+
+            this->copy = ARRAY(new Array(std::move(elements)));
         }
 
-        encoded += "\n}";
+        this->copy->set(i, v);
+    }
+
+    string ArrayView::name() const {
+        return "ARRAY";
+    }
+
+    string ArrayView::encoded() const {
+        string encoded;
+        Writer out(encoded);
+
+        this->write(out);
+        out.flush();
 
         return encoded;
     }
 
-    VALUE Object::get(const string& k) {
-        try {
-            return this->value.at(k);
-        }
-        catch(std::out_of_range e) {
-            throw BasicRuntimeError(k + " is not a valid symbol");
+    void ArrayView::write(Writer& out) const {
+        if(this->copy) return this->copy->write(out);
+
+        out.put('[');
+        out.indent();
+
+        for(int64_t i=0; i<this->size(); i++) {
+            if(i) out.put(',');
+
+            out.newline();
+            this->element(i)->write(out);
         }
-    }
 
-    void Object::set(const string& k, VALUE v) {
-        this->value[k] = v;
+        out.dedent();
+        out.newline();
+        out.put(']');
     }
 
-    bool Object::has(const string& k) {
-        return this->value.count(k) > 0;
+    const type_info& ArrayView::type() const {
+        return typeid(ArrayView);
     }
 
-    string Object::name() const {
-        return "OBJECT";
+    bool ArrayView::istrue() const {
+        return this->length() ? true : false;
     }
 
-    string Object::encoded() const {
-        return this->encode(this->value);
+    int64_t ArrayView::length() const {
+        return this->copy ? this->copy->length() : this->size();
     }
 
-    const type_info& Object::type() const {
-        return typeid(*this);
+    string ArrayView::svalue() const {
+        return this->encoded();
     }
 
-    bool Object::istrue() const {
-        return this->value.size() ? true : false;
+    /* Arrays are equal when they hold the same values.  A view makes its
+    * elements as they are read, so it is equal only to itself. */
+    VALUE ArrayView::op_eq(const VALUE other) const {
+        return VALUE(new Integer(resolved(other).get() == static_cast<const Value*>(this)));
     }
 
-    int64_t Object::length() const {
-        return this->value.size();
+    VALUE ArrayView::op_ne(const VALUE other) const {
+        return VALUE(new Integer(!this->op_eq(other)->istrue()));
     }
 
-    const map<string,VALUE>& Object::ovalue() const {
-        return this->native();
+    ObjectView::ObjectView() {
+        this->copyOnWrite = false;
     }
 
-    string Object::svalue() const {
-        return this->encoded();
+    void ObjectView::setCopyOnWrite(bool enabled) {
+        this->copyOnWrite = enabled;
     }
 
-    VALUE Object::op_eq(const VALUE other) const {
-        if(other->type() == typeid(Object)) return VALUE(new Integer(this->value == other->ovalue()));
+    /* Every member, read now */
+    map<string,VALUE> ObjectView::members() const {
+        map<string,VALUE> members;
 
-        return VALUE(new Integer(0));
-    }
+        if(this->copy) return this->copy->native();
 
-    VALUE Object::op_ne(const VALUE other) const {
-        if(other->type() == typeid(Object)) return VALUE(new Integer(this->value != other->ovalue()));
+        for(const string& k : this->keys()) members.emplace(k, this->member(k));
 
-        return VALUE(new Integer(1));
+        return members;
+    }
+
+    /* The value of k, or nullptr if there is none */
+    VALUE ObjectView::find(const string& k) const {
+        return this->copy ? this->copy->find(k) : this->member(k);
     }
 
+    VALUE ObjectView::get(const string& k) const {
+        VALUE found = this->find(k);
 
-    /* ***************************************************************************
-    * SYMBOL TABLE
-    */
+        if(!found) throw BasicRuntimeError(ErrorCode::UNKNOWN_SYMBOL, nullptr, k);
 
-    SymbolTable::SymbolTable(initializer_list<pair<string,VALUE> > init): Object(init) {
-        this->value.insert(builtins.begin(), builtins.end());
+        return found;
     }
 
-    SymbolTable::SymbolTable(SYMBOLS parent) {
-        this->parent = parent;
-        this->root = parent;
+    void ObjectView::set(const string& k, VALUE v) {
+        if(!this->copy) {
+            if(!this->copyOnWrite) throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERATION, "=", "read-only " + this->name());
 
-        if(this->parent == nullptr) {
-            this->value.insert(builtins.begin(), builtins.end());
-        }
-        else {
-            this->root = parent->root ? parent->root : parent;
-            this->set("UPSCOPE", parent);
-            this->set("GLOBAL", this->root);
+            this->copy = OBJECT(new Object(this->members()));
         }
+
+        this->copy->set(k, v);
     }
 
-    VALUE SymbolTable::get(const string& k) {
-        if(Object::has(k) || !this->parent) {
-            return Object::get(k);
-        }
+    string ObjectView::name() const {
+        return "OBJECT";
+    }
 
-        return this->parent->get(k);
+    string ObjectView::encoded() const {
+        return Object::encode(this->members());
     }
 
-    void SymbolTable::set(const string& k, VALUE v) {
-        if(this->parent && this->parent->has(k)) {
-            this->parent->set(k, v);
-        }
+    void ObjectView::write(Writer& out) const {
+        Object::encode(out, this->members());
+    }
 
-        return Object::set(k, v);
+    const type_info& ObjectView::type() const {
+        return typeid(ObjectView);
     }
 
-    bool SymbolTable::has(const string& k) {
-        bool hasit = Object::has(k);
+    bool ObjectView::istrue() const {
+        return this->length() ? true : false;
+    }
 
-        if(this->parent) {
-            hasit = hasit || this->parent->has(k);
-        }
+    int64_t ObjectView::length() const {
+        return this->copy ? this->copy->length() : this->keys().size();
+    }
 
-        return hasit;
+    string ObjectView::svalue() const {
+        return this->encoded();
     }
 
-    string SymbolTable::encoded() const {
-        return this->encode(this->value, this->parent);
+    /* Like an array view, equal only to itself */
+    VALUE ObjectView::op_eq(const VALUE other) const {
+        return VALUE(new Integer(resolved(other).get() == static_cast<const Value*>(this)));
     }
 
+    VALUE ObjectView::op_ne(const VALUE other) const {
+        return VALUE(new Integer(!this->op_eq(other)->istrue()));
+    }
 
-    /* ***************************************************************************
-    * FUNCTION
-    */
+    TypedArray::TypedArray(const int64_t* data, int64_t size, shared_ptr<const void> owner) {
+        this->owner = owner;
+        this->data = data;
+        this->count = size;
+        this->elementType = ElementType::INT64;
+    }
 
-    Function::Function(VALUE (*func)(const vector<VALUE>&), int64_t minargs, int64_t maxargs) {
-        this->func = func;
-        this->dfunc = nullptr;
+    TypedArray::TypedArray(const double* data, int64_t size, shared_ptr<const void> owner) {
+        this->owner = owner;
+        this->data = data;
+        this->count = size;
+        this->elementType = ElementType::DOUBLE;
+    }
+
+    ElementType TypedArray::getElementType() const {
+        return this->elementType;
+    }
+
+    const void* TypedArray::native() const {
+        return this->data;
+    }
+
+    int64_t TypedArray::size() const {
+        return this->count;
+    }
+
+    VALUE TypedArray::element(int64_t i) const {
+        if(this->elementType == ElementType::DOUBLE) return VALUE(new Double(static_cast<const double*>(this->data)[i]));
+
+        return VALUE(new Integer(static_cast<const int64_t*>(this->data)[i]));
+    }
+
+    /* Written without boxing the elements */
+    void TypedArray::write(Writer& out) const {
+        if(this->copied()) return ArrayView::write(out);
+
+        out.put('[');
+        out.indent();
+
+        for(int64_t i=0; i<this->count; i++) {
+            if(i) out.put(',');
+
+            out.newline();
+
+            if(this->elementType == ElementType::DOUBLE) Double(static_cast<const double*>(this->data)[i]).write(out);
+            else Integer(static_cast<const int64_t*>(this->data)[i]).write(out);
+        }
+
+        out.dedent();
+        out.newline();
+        out.put(']');
+    }
+
+    StringArrayView::StringArrayView(const vector<string>& data, shared_ptr<const void> owner) {
+        this->owner = owner;
+        this->data = &data;
+    }
+
+    int64_t StringArrayView::size() const {
+        return this->data->size();
+    }
+
+    VALUE StringArrayView::element(int64_t i) const {
+        return VALUE(new String((*this->data)[i]));
+    }
+
+
+    /* ***************************************************************************
+    * OBJECT
+    */
+
+    Object::Object() {
+        this->accounted = 0;
+    }
+
+    Object::Object(initializer_list<pair<string,VALUE> > init) {
+        for(auto rec : init) {
+            this->value[rec.first] = rec.second;
+        }
+
+        this->accounted = 0;
+        this->account();
+    }
+
+    Object::Object(const map<string,VALUE>& v) {
+        this->value = v;
+        this->accounted = 0;
+        this->account();
+    }
+
+    Object::Object(map<string,VALUE>&& v) {
+        this->value = std::move(v);
+        this->accounted = 0;
+        this->account();
+    }
+
+    Object::~Object() {
+        refund(this->charged, this->accounted);
+    }
+
+    /* Charge for the entries after a change to many of them */
+    void Object::account() {
+        int64_t bytes = 0;
+
+        for(const auto& kv : this->value) {
+            bytes += node_bytes<VALUE>(kv.first);
+        }
+
+        if(bytes > this->accounted) charge(this->charged, bytes - this->accounted);
+        else refund(this->charged, this->accounted - bytes);
+
+        this->accounted = bytes;
+    }
+
+    const map<string,VALUE>& Object::native() const {
+        return this->value;
+    }
+
+    string Object::encode(const map<string,VALUE>& decoded, SYMBOLS parent) {
+        string encoded;
+        Writer out(encoded);
+
+        encode(out, decoded, parent);
+
+        return encoded;
+    }
+
+    void Object::encode(Writer& out, const map<string,VALUE>& decoded, SYMBOLS parent) {
+        const char* colon = out.isPretty() ? " : " : ":";
+        int i = 0;
+
+        out.put('{');
+        out.indent();
+
+        if(parent) {
+            out.newline();
+            out.put("__PARENT__");
+            out.put(colon);
+            parent->write(out);
+
+            i++;
+        }
+
+        for(const pair<const string,VALUE>& pi: decoded) {
+            if(i++) out.put(',');
+
+            out.newline();
+            out.put(pi.first);
+            out.put(colon);
+
+            if(pi.first == "GLOBAL" || pi.first == "UPSCOPE") {
+                out.put('<');
+                out.put(pi.first);
+                out.put('>');
+            }
+            else {
+                pi.second->write(out);
+            }
+        }
+
+        out.dedent();
+        out.newline();
+        out.put('}');
+    }
+
+    /* The value of k, or nullptr if there is none */
+    VALUE Object::find(const string& k) {
+        auto found = this->value.find(k);
+
+        return (found != this->value.end()) ? found->second : nullptr;
+    }
+
+    VALUE Object::get(const string& k) {
+        VALUE found = this->find(k);
+
+        if(!found) throw BasicRuntimeError(ErrorCode::UNKNOWN_SYMBOL, nullptr, k);
+
+        return found;
+    }
+
+    void Object::set(const string& k, VALUE v) {
+        auto found = this->value.find(k);
+
+        if(found != this->value.end()) {
+            found->second = v;
+        }
+        else {
+            int64_t bytes = node_bytes<VALUE>(k);
+
+            charge(this->charged, bytes);
+            this->value.emplace(k, v);
+            this->accounted += bytes;
+        }
+    }
+
+    bool Object::has(const string& k) {
+        return this->value.count(k) > 0;
+    }
+
+    string Object::name() const {
+        return "OBJECT";
+    }
+
+    string Object::encoded() const {
+        return this->encode(this->value);
+    }
+
+    void Object::write(Writer& out) const {
+        encode(out, this->value);
+    }
+
+    const type_info& Object::type() const {
+        return typeid(*this);
+    }
+
+    bool Object::istrue() const {
+        return this->value.size() ? true : false;
+    }
+
+    int64_t Object::length() const {
+        return this->value.size();
+    }
+
+    const map<string,VALUE>& Object::ovalue() const {
+        return this->native();
+    }
+
+    string Object::svalue() const {
+        return this->encoded();
+    }
+
+    VALUE Object::op_eq(const VALUE other) const {
+        if(other->type() == typeid(Object)) return VALUE(new Integer(this->value == other->ovalue()));
+
+        return VALUE(new Integer(0));
+    }
+
+    VALUE Object::op_ne(const VALUE other) const {
+        if(other->type() == typeid(Object)) return VALUE(new Integer(this->value != other->ovalue()));
+
+        return VALUE(new Integer(1));
+    }
+
+
+    void Object::traverse(vector<Value*>& refs) const {
+        for(const auto& kv : this->value) refs.push_back(kv.second.get());
+    }
+
+    void Object::clear() {
+        this->value.clear();
+        this->account();
+    }
+
+
+    /* ***************************************************************************
+    * SYMBOL TABLE
+    */
+
+    SymbolTable::SymbolTable(initializer_list<pair<string,VALUE> > init): Object(init) {
+        this->value.insert(builtins.begin(), builtins.end());
+        this->linked = true;
+        this->account();
+    }
+
+    SymbolTable::SymbolTable(SYMBOLS parent) {
+        this->parent = parent;
+        this->root = parent;
+        this->linked = false;
+
+        if(this->parent == nullptr) {
+            this->value.insert(builtins.begin(), builtins.end());
+            this->linked = true;
+            this->account();
+        }
+        else {
+            this->root = parent->root ? parent->root : parent;
+        }
+    }
+
+    /* UPSCOPE and GLOBAL are resolved from parent and root until the table
+    * is inspected as a whole, at which point they are stored like any other
+    * symbol. */
+    void SymbolTable::link() const {
+        if(this->linked) return;
+
+        SymbolTable* self = const_cast<SymbolTable*>(this);
+
+        self->value.insert({ "UPSCOPE", this->parent });
+        self->value.insert({ "GLOBAL", this->root });
+        self->linked = true;
+        self->account();
+    }
+
+    /* Symbols not in the table are asked of the resolver, which is asked
+    * about each symbol at most once.  UPSCOPE and GLOBAL are never asked
+    * about; they name scopes, not inputs. */
+    void SymbolTable::setResolver(Resolver resolver) {
+        this->resolver = resolver;
+        this->unresolved.clear();
+    }
+
+    /* Symbols loaded by the resolver are not reported to the observer */
+    void SymbolTable::setObserver(Observer observer) {
+        this->observer = observer;
+    }
+
+    VALUE SymbolTable::resolve(const string& k) {
+        if(!this->resolver || this->unresolved.count(k)) return nullptr;
+        if(k == "UPSCOPE" || k == "GLOBAL") return nullptr;
+
+        VALUE value = this->resolver(k);
+
+        if(value) Object::set(k, value);
+        else this->unresolved.insert(k);
+
+        return value;
+    }
+
+    VALUE SymbolTable::find(const string& k) {
+        VALUE found = Object::find(k);
+
+        if(!found && this->resolver) found = this->resolve(k);
+        if(found || !this->parent) return found;
+
+        if(!this->linked && k == "UPSCOPE") return this->parent;
+        if(!this->linked && k == "GLOBAL") return this->root;
+
+        return this->parent->find(k);
+    }
+
+    void SymbolTable::set(const string& k, VALUE v) {
+        if(this->parent && this->parent->has(k)) {
+            this->parent->set(k, v);
+        }
+
+        Object::set(k, v);
+
+        if(this->observer) this->observer(k);
+    }
+
+    bool SymbolTable::has(const string& k) {
+        bool hasit = Object::has(k) || (this->resolver && this->resolve(k));
+
+        if(this->parent) {
+            hasit = hasit || k == "UPSCOPE" || k == "GLOBAL" || this->parent->has(k);
+        }
+
+        return hasit;
+    }
+
+    void SymbolTable::define(const string& k, VALUE v) {
+        Object::set(k, v);
+
+        if(this->observer) this->observer(k);
+    }
+
+    string SymbolTable::encoded() const {
+        this->link();
+
+        return this->encode(this->value, this->parent);
+    }
+
+    void SymbolTable::write(Writer& out) const {
+        this->link();
+
+        encode(out, this->value, this->parent);
+    }
+
+    bool SymbolTable::istrue() const {
+        this->link();
+
+        return Object::istrue();
+    }
+
+    int64_t SymbolTable::length() const {
+        this->link();
+
+        return Object::length();
+    }
+
+    const map<string,VALUE>& SymbolTable::ovalue() const {
+        this->link();
+
+        return Object::ovalue();
+    }
+
+    void SymbolTable::traverse(vector<Value*>& refs) const {
+        Object::traverse(refs);
+
+        refs.push_back(this->parent.get());
+        refs.push_back(this->root.get());
+    }
+
+    void SymbolTable::clear() {
+        Object::clear();
+
+        this->parent = nullptr;
+        this->root = nullptr;
+        this->resolver = nullptr;
+        this->observer = nullptr;
+    }
+
+
+    /* ***************************************************************************
+    * CAPTURES
+    */
+
+    /* The scope a closure runs in when it needs only some of the variables
+    * visible where it was defined.  Each name refers to the defining scope,
+    * so reads and writes go through the same scope chain they would without
+    * the closure, including names that are assigned only later. */
+    Captures::Captures(SYMBOLS scope, const std::set<string>& names): SymbolTable(scope) {
+        this->parent = nullptr;
+        this->linked = true;
+
+        for(const string& k : names) this->cells[k] = scope;
+
+        for(const auto& cell : this->cells) {
+            int64_t bytes = node_bytes<SYMBOLS>(cell.first);
+
+            charge(this->charged, bytes);
+            this->accounted += bytes;
+        }
+    }
+
+    Captures::~Captures() {
+        refund(this->charged, this->accounted);
+        this->accounted = 0;
+    }
+
+    VALUE Captures::find(const string& k) {
+        auto cell = this->cells.find(k);
+
+        return (cell != this->cells.end()) ? cell->second->find(k) : this->root->find(k);
+    }
+
+    void Captures::set(const string& k, VALUE v) {
+        auto cell = this->cells.find(k);
+
+        if(cell != this->cells.end()) cell->second->set(k, v);
+        else this->root->set(k, v);
+    }
+
+    bool Captures::has(const string& k) {
+        auto cell = this->cells.find(k);
+
+        return (cell != this->cells.end()) ? cell->second->has(k) : this->root->has(k);
+    }
+
+    const type_info& Captures::type() const {
+        return typeid(SymbolTable);
+    }
+
+    void Captures::traverse(vector<Value*>& refs) const {
+        SymbolTable::traverse(refs);
+
+        for(const auto& cell : this->cells) refs.push_back(cell.second.get());
+    }
+
+    void Captures::clear() {
+        this->cells.clear();
+
+        SymbolTable::clear();
+    }
+
+
+    /* ***************************************************************************
+    * FUNCTION
+    */
+
+    /*
+    * What a MEMO() function has returned, by the values of its arguments.
+    * The function it wraps is a closure, or a host function that takes
+    * values.
+    */
+    class Memo {
+        shared_ptr<ResultCache> results;
+
+        public:
+            FUNCTION memoized;
+
+            Memo(FUNCTION memoized, int64_t capacity);
+            VALUE call(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor);
+    };
+
+    Function::Function(VALUE (*func)(const vector<VALUE>&), int64_t minargs, int64_t maxargs) {
+        this->func = func;
+        this->dfunc = nullptr;
+        this->xfunc = nullptr;
+        this->staticExpr = nullptr;
+        this->minargs = minargs;
+        this->maxargs = maxargs;
+        this->scope = nullptr;
+        this->pure = false;
+    }
+
+    Function::Function(VALUE (*dfunc)(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor), int64_t minargs, int64_t maxargs) {
+        this->func = nullptr;
+        this->dfunc = dfunc;
         this->xfunc = nullptr;
         this->staticExpr = nullptr;
         this->minargs = minargs;
         this->maxargs = maxargs;
         this->scope = nullptr;
+        this->pure = false;
+    }
+
+    Function::Function(VALUE (*xfunc)(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor, SYMBOLS scope), SYMBOLS scope, int64_t minargs, int64_t maxargs) {
+        this->func = nullptr;
+        this->dfunc = nullptr;
+        this->xfunc = xfunc;
+        this->staticExpr = nullptr;
+        this->minargs = minargs;
+        this->maxargs = maxargs;
+        this->scope = scope;
+        this->pure = false;
+    }
+
+    /* A function that remembers what memoized returns, as MEMO() makes */
+    Function::Function(FUNCTION memoized, int64_t capacity) {
+        this->func = nullptr;
+        this->dfunc = nullptr;
+        this->xfunc = nullptr;
+        this->staticExpr = nullptr;
+        this->minargs = memoized->minargs;
+        this->maxargs = memoized->maxargs;
+        this->scope = nullptr;
+        this->memo.reset(new Memo(memoized, capacity));
+        this->pure = memoized->pure;
+    }
+
+    VALUE Function::call(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor) const {
+        this->checkArgs(vexpr.size());
+
+        if(this->memo) {
+            return this->memo->call(vexpr, visitor);
+        }
+        else if(this->func) {
+            vector<VALUE> args;
+
+            for(LiteExprParser::ExprContext* expr : vexpr) {
+                args.push_back(any_cast<VALUE>(visitor->visit(expr)));
+            }
+
+            return this->func(args);
+        }
+        else if(this->xfunc) {
+           vector<LiteExprParser::ExprContext*> sexpr;
+
+           sexpr.push_back(this->staticExpr);
+           sexpr.insert(sexpr.end(), vexpr.begin(), vexpr.end());
+
+           return this->xfunc(sexpr, visitor, this->scope);
+        }
+        else if(this->staticExpr) {
+           vector<LiteExprParser::ExprContext*> sexpr;
+
+           sexpr.push_back(this->staticExpr);
+           sexpr.insert(sexpr.end(), vexpr.begin(), vexpr.end());
+
+           return this->dfunc(sexpr, visitor);
+        }
+        else {
+            return this->dfunc(vexpr, visitor);
+        }
+    }
+
+    void Function::checkArgs(int64_t count) const {
+        if(count < this->minargs || this->maxargs < count) {
+            throw BasicSyntaxError(ErrorCode::ARGUMENT_COUNT, string("Invalid argument count. min=")
+                + std::to_string(this->minargs) + ", max="
+                + std::to_string(this->maxargs) + ", got="
+                + std::to_string(count)
+            );
+        }
+    }
+
+    /* Whether the function is passed its arguments unevaluated */
+    bool Function::isDeferred() const {
+        return !this->func;
+    }
+
+    /* Whether the function was created by FUNCTION() */
+    bool Function::isClosure() const {
+        return this->xfunc == builtin_closure;
+    }
+
+    /* Whether the host has declared that the function's result depends only
+    * on its arguments, and that calling it changes nothing */
+    bool Function::isPure() const {
+        return this->pure;
+    }
+
+    SYMBOLS Function::getScope() const {
+        return this->scope;
+    }
+
+    LiteExprParser::ExprContext* Function::getStaticExpr() const {
+        return this->staticExpr;
+    }
+
+    string Function::name() const {
+        return "Function";
+    }
+
+    string Function::encoded() const {
+        return "<Function>";
+    }
+
+    const type_info& Function::type() const {
+        return typeid(*this);
+    }
+
+    void Function::setStaticExpr(LiteExprParser::ExprContext* staticExpr) {
+        this->staticExpr = staticExpr;
+    }
+
+    void Function::setPure(bool pure) {
+        this->pure = pure;
+    }
+
+    void Function::traverse(vector<Value*>& refs) const {
+        refs.push_back(this->scope.get());
+
+        if(this->memo) refs.push_back(this->memo->memoized.get());
+    }
+
+    void Function::clear() {
+        this->scope = nullptr;
+
+        if(this->memo) this->memo->memoized = nullptr;
+    }
+}
+
+
+/* ***************************************************************************
+* VARIABLE
+*/
+
+namespace liteexpr {
+    Ident::Ident(VALUE container, VALUE key) {
+        this->container = container;
+        this->key = key;
+    }
+
+    Ident::~Ident() {
+        this->container = nullptr;
+        this->key = nullptr;
+    }
+
+    void Ident::set(VALUE other) {
+        if(this->container->type() == typeid(ArrayView)) {
+            ARRAYVIEW array = dynamic_pointer_cast<ArrayView>(this->container);
+
+            array->set(this->key->ivalue(), other);
+            return;
+        }
+
+        if(this->container->type() == typeid(ObjectView)) {
+            OBJECTVIEW object = dynamic_pointer_cast<ObjectView>(this->container);
+
+            object->set(this->key->svalue(), other);
+            return;
+        }
+
+        if(this->container->type() == typeid(Array)) {
+            ARRAY array = dynamic_pointer_cast<Array>(this->container);
+
+            array->set(this->key->ivalue(), other);
+            return;
+        }
+
+        if(this->container->type() == typeid(Object) || this->container->type() == typeid(SymbolTable)) {
+            OBJECT object = dynamic_pointer_cast<Object>(this->container);
+
+            object->set(this->key->svalue(), other);
+            return;
+        }
+
+        throw BasicRuntimeError(string("Invalid identifier set type: ") + this->container->type().name());
+    }
+
+    /* The value referred to, or nullptr if the key is not there */
+    VALUE Ident::find() const {
+        if(this->container->type() == typeid(Array)) {
+            ARRAY array = dynamic_pointer_cast<Array>(this->container);
+
+            return array->find(this->key->ivalue());
+        }
+
+        if(this->container->type() == typeid(ArrayView)) {
+            ARRAYVIEW array = dynamic_pointer_cast<ArrayView>(this->container);
+
+            return array->find(this->key->ivalue());
+        }
+
+        if(this->container->type() == typeid(ObjectView)) {
+            OBJECTVIEW object = dynamic_pointer_cast<ObjectView>(this->container);
+
+            return object->find(this->key->svalue());
+        }
+
+        if(this->container->type() == typeid(Object) || this->container->type() == typeid(SymbolTable)) {
+            OBJECT object = dynamic_pointer_cast<Object>(this->container);
+
+            return object->find(this->key->svalue());
+        }
+
+        throw BasicRuntimeError(string("Invalid identifier get type: ") + this->container->type().name());
+    }
+
+    VALUE Ident::get() const {
+        if(this->container->type() == typeid(Array)) {
+            ARRAY array = dynamic_pointer_cast<Array>(this->container);
+            VALUE value = array->get(this->key->ivalue());
+
+            return value;
+        }
+
+        if(this->container->type() == typeid(ArrayView)) {
+            ARRAYVIEW array = dynamic_pointer_cast<ArrayView>(this->container);
+
+            return array->get(this->key->ivalue());
+        }
+
+        if(this->container->type() == typeid(ObjectView)) {
+            OBJECTVIEW object = dynamic_pointer_cast<ObjectView>(this->container);
+
+            return object->get(this->key->svalue());
+        }
+
+        if(this->container->type() == typeid(Object) || this->container->type() == typeid(SymbolTable)) {
+            OBJECT object = dynamic_pointer_cast<Object>(this->container);
+            VALUE value = object->get(this->key->svalue());
+
+            return value;
+        }
+
+        throw BasicRuntimeError(string("Invalid identifier get type: ") + this->container->type().name());
+    }
+
+    VALUE Ident::getkey() const {
+        return this->key;
+    }
+
+    string Ident::name() const { return this->get()->name(); }
+    string Ident::encoded() const { return this->get()->encoded(); }
+    void Ident::write(Writer& out) const { this->get()->write(out); }
+    const type_info& Ident::type() const { return this->get()->type(); }
+    bool Ident::istrue() const { return this->get()->istrue(); }
+    int64_t Ident::length() const { return this->get()->length(); }
+    int64_t Ident::ivalue() const { return this->get()->ivalue(); }
+    double Ident::dvalue() const { return this->get()->dvalue(); }
+    string Ident::svalue() const { return this->get()->svalue(); }
+    const vector<VALUE>& Ident::avalue() const { return this->get()->avalue(); }
+    const map<string,VALUE>& Ident::ovalue() const { return this->get()->ovalue(); }
+    VALUE Ident::op_not() const { return this->get()->op_not(); }
+    VALUE Ident::op_inv() const { return this->get()->op_inv(); }
+    VALUE Ident::op_pos() const { return this->get()->op_pos(); }
+    VALUE Ident::op_neg() const { return this->get()->op_neg(); }
+    VALUE Ident::op_inc() const { return this->get()->op_inc(); }
+    VALUE Ident::op_dec() const { return this->get()->op_dec(); }
+    VALUE Ident::op_lt(const VALUE other) const { return this->get()->op_lt(other); }
+    VALUE Ident::op_gt(const VALUE other) const { return this->get()->op_gt(other); }
+    VALUE Ident::op_eq(const VALUE other) const { return this->get()->op_eq(other); }
+    VALUE Ident::op_ne(const VALUE other) const { return this->get()->op_ne(other); }
+    VALUE Ident::op_lte(const VALUE other) const { return this->get()->op_lte(other); }
+    VALUE Ident::op_gte(const VALUE other) const { return this->get()->op_gte(other); }
+    VALUE Ident::op_pow(const VALUE other) const { return this->get()->op_pow(other); }
+    VALUE Ident::op_mul(const VALUE other) const { return this->get()->op_mul(other); }
+    VALUE Ident::op_div(const VALUE other) const { return this->get()->op_div(other); }
+    VALUE Ident::op_add(const VALUE other) const { return this->get()->op_add(other); }
+    VALUE Ident::op_sub(const VALUE other) const { return this->get()->op_sub(other); }
+    VALUE Ident::op_mod(const VALUE other) const { return this->get()->op_mod(other); }
+    VALUE Ident::op_shl(const VALUE other) const { return this->get()->op_shl(other); }
+    VALUE Ident::op_asr(const VALUE other) const { return this->get()->op_asr(other); }
+    VALUE Ident::op_shr(const VALUE other) const { return this->get()->op_shr(other); }
+    VALUE Ident::op_and(const VALUE other) const { return this->get()->op_and(other); }
+    VALUE Ident::op_xor(const VALUE other) const { return this->get()->op_xor(other); }
+    VALUE Ident::op_or(const VALUE other) const { return this->get()->op_or(other); }
+
+    void Ident::traverse(vector<Value*>& refs) const {
+        refs.push_back(this->container.get());
+        refs.push_back(this->key.get());
+    }
+
+    void Ident::clear() {
+        this->container = nullptr;
+        this->key = nullptr;
+    }
+}
+
+
+/* ***************************************************************************
+* EVALUATOR
+*/
+
+namespace liteexpr {
+    typedef pair<string,VALUE> Pair;
+    typedef vector<Pair> PairList;
+    typedef vector<VALUE> List;
+
+    /*
+    * A call in tail position, handed back to the closure that made it.
+    */
+    class TailCall: public Value {
+        public:
+            SYMBOLS upscope;
+            LiteExprParser::ExprContext* body;
+            vector<VALUE> args;
+
+            TailCall(SYMBOLS upscope, LiteExprParser::ExprContext* body, vector<VALUE>&& args) {
+                this->upscope = upscope;
+                this->body = body;
+                this->args = std::move(args);
+            }
+
+            string name() const override { return "TailCall"; }
+            string encoded() const override { return "TailCall"; }
+            const type_info& type() const override { return typeid(TailCall); }
+    };
+
+    /*
+    * Run a closure body on the caller's evaluator, one frame at a time.
+    */
+    static VALUE run_closure(Evaluator* visitor, SYMBOLS upscope, LiteExprParser::ExprContext* body, vector<VALUE>&& args) {
+        while(true) {
+            SYMBOLS scope(new SymbolTable(upscope));
+            Evaluator::Frame frame(visitor, scope);
+
+            scope->define("ARG", VALUE(new Array(std::move(args))));
+
+            VALUE result = any_cast<VALUE>(visitor->visitTail(body));
+            shared_ptr<TailCall> next = dynamic_pointer_cast<TailCall>(result);
+
+            if(!next) return result;
+
+            upscope = next->upscope;
+            body = next->body;
+            args = std::move(next->args);
+        }
+    }
+
+    /*
+    * Whether a closure body is small enough to inline and never refers to its
+    * own scope: no assignments, no UPSCOPE or GLOBAL, and ARG only indexed.
+    * Calls to built-ins that bind or evaluate names are ruled out by name;
+    * other deferred calls make the inlined body materialize a real scope.
+    */
+    static const int INLINE_BUDGET = 48;
+
+    static bool is_inlinable(antlr4::tree::ParseTree* node, int& budget) {
+        if(--budget < 0) return false;
+
+        if(dynamic_cast<LiteExprParser::AssignOpContext*>(node)) return false;
+        if(dynamic_cast<LiteExprParser::PrefixOpContext*>(node)) return false;
+        if(dynamic_cast<LiteExprParser::PostfixOpContext*>(node)) return false;
+
+        if(auto call = dynamic_cast<LiteExprParser::CallContext*>(node)) {
+            auto callee = dynamic_cast<LiteExprParser::SimpleVarContext*>(call->varname());
+
+            if(!callee) return false;
+
+            for(const char* name : { "ARG", "UPSCOPE", "GLOBAL", "EVAL", "FOR", "FOREACH", "FUNCTION", "WHILE" }) {
+                if(callee->ID()->getText() == name) return false;
+            }
+
+            return is_inlinable(call->list(), budget);
+        }
+
+        if(auto var = dynamic_cast<LiteExprParser::IndexedVarContext*>(node)) {
+            auto base = dynamic_cast<LiteExprParser::SimpleVarContext*>(var->varname());
+
+            if(base && base->ID()->getText() == "ARG") return is_inlinable(var->expr(), budget);
+        }
+
+        if(auto var = dynamic_cast<LiteExprParser::SimpleVarContext*>(node)) {
+            string name = var->ID()->getText();
+
+            return name != "ARG" && name != "UPSCOPE" && name != "GLOBAL";
+        }
+
+        for(auto child : node->children) {
+            if(!is_inlinable(child, budget)) return false;
+        }
+
+        return true;
+    }
+
+    /* Built-ins whose result depends only on their arguments */
+    static const std::set<string> PURE_BUILTINS = { "CEIL", "FLOOR", "LEN", "ROUND", "SQRT" };
+
+    /*
+    * Whether an expression assigns nothing and calls only pure built-ins, or
+    * pure host functions found in functions, if given.
+    */
+    static bool is_pure(antlr4::tree::ParseTree* node, SYMBOLS functions=nullptr) {
+        if(dynamic_cast<LiteExprParser::AssignOpContext*>(node)) return false;
+        if(dynamic_cast<LiteExprParser::PrefixOpContext*>(node)) return false;
+        if(dynamic_cast<LiteExprParser::PostfixOpContext*>(node)) return false;
+
+        if(auto call = dynamic_cast<LiteExprParser::CallContext*>(node)) {
+            auto callee = dynamic_cast<LiteExprParser::SimpleVarContext*>(call->varname());
+            string name = callee ? callee->ID()->getText() : "";
+            FUNCTION function = (callee && functions) ? dynamic_pointer_cast<Function>(resolved(functions->find(name))) : nullptr;
+
+            if(!callee) return false;
+            bool builtin = PURE_BUILTINS.count(name) && (!functions || is_builtin(resolved(functions->find(name)), name));
+
+            if(!builtin && !(function && function->isPure())) return false;
+        }
+
+        for(auto child : node->children) {
+            if(!is_pure(child, functions)) return false;
+        }
+
+        return true;
+    }
+
+    /* Whether an expression is pure and always 0 or 1 */
+    static bool is_predicate(LiteExprParser::ExprContext* expr) {
+        if(auto paren = dynamic_cast<LiteExprParser::ParenContext*>(expr)) return is_predicate(paren->expr());
+
+        if(auto op = dynamic_cast<LiteExprParser::UnaryOpContext*>(expr)) {
+            return op->op->getText() == "!" && is_pure(op->expr());
+        }
+
+        if(auto op = dynamic_cast<LiteExprParser::BinaryOpContext*>(expr)) {
+            string optext = op->op->getText();
+
+            if(optext == "&&" || optext == "||") return is_predicate(op->expr(0)) && is_predicate(op->expr(1));
+
+            for(const char* comparison : { "==", "!=", "<", "<=", ">", ">=" }) {
+                if(optext == comparison) return is_pure(op);
+            }
+        }
+
+        return false;
+    }
+
+    /* The operands of a chain of one operator, in the order they are evaluated */
+    static void operands(LiteExprParser::ExprContext* expr, const string& optext, vector<LiteExprParser::ExprContext*>& out) {
+        auto paren = dynamic_cast<LiteExprParser::ParenContext*>(expr);
+        auto op = dynamic_cast<LiteExprParser::BinaryOpContext*>(expr);
+
+        if(paren) return operands(paren->expr(), optext, out);
+
+        if(op && op->op->getText() == optext) {
+            operands(op->expr(0), optext, out);
+            operands(op->expr(1), optext, out);
+        }
+        else out.push_back(expr);
+    }
+
+    /*
+    * Chains of && and || whose operands are all pure and 0 or 1, so the
+    * order they are evaluated in doesn't change a result that is reached.
+    * Every REORDER_PERIOD evaluations, a chain's operands are sorted by their
+    * average cost over how often they decide it.  If an operand fails out of
+    * order, the chain is evaluated again in its written order, and stays in
+    * it, so the error is the one it would have been.  Errors are not found
+    * ahead of time, though: a chain decided early skips an operand that
+    * would have failed in its written order, and gives a result instead.
+    */
+    static const size_t REORDER_PERIOD = 64;
+
+    class Reordering {
+        struct Entry {
+            vector<LiteExprParser::ExprContext*> exprs;
+            Chain chain;
+        };
+
+        antlr4::tree::ParseTree* root;
+        shared_ptr<const string> source;
+        std::unordered_map<antlr4::tree::ParseTree*,std::unique_ptr<Entry> > entries;
+
+        Entry* find(LiteExprParser::BinaryOpContext* ctx);
+        void reorder(Entry& entry);
+
+        public:
+            Reordering(antlr4::tree::ParseTree* root, shared_ptr<const string> source): root(root), source(source) {}
+            VALUE eval(LiteExprParser::BinaryOpContext* ctx, Evaluator* evaluator);
+            vector<Chain> chains() const;
+    };
+
+    /* The chain ctx starts, or nullptr if it can't be reordered */
+    Reordering::Entry* Reordering::find(LiteExprParser::BinaryOpContext* ctx) {
+        auto found = this->entries.find(ctx);
+
+        if(found != this->entries.end()) return found->second.get();
+
+        /* Chains of other programs, such as the body of a function they
+        * defined, are evaluated as written */
+        antlr4::tree::ParseTree* top = ctx;
+
+        while(top->parent) top = top->parent;
+
+        if(top != this->root) return nullptr;
+
+        std::unique_ptr<Entry> entry(new Entry());
+        string op = ctx->op->getText();
+        antlr4::tree::ParseTree* parent = ctx->parent;
+        bool eligible = true;
+
+        while(dynamic_cast<LiteExprParser::ParenContext*>(parent)) parent = parent->parent;
+
+        auto outer = dynamic_cast<LiteExprParser::BinaryOpContext*>(parent);
+
+        /* Only the outermost operator of a chain */
+        if(outer && outer->op->getText() == op) eligible = false;
+
+        operands(ctx, op, entry->exprs);
+
+        for(auto expr : entry->exprs) eligible = eligible && is_predicate(expr);
+
+        if(!eligible) entry = nullptr;
+        else {
+            entry->chain.op = op;
+
+            for(size_t i = 0; i < entry->exprs.size(); i++) {
+                auto expr = entry->exprs[i];
+                Operand operand;
+
+                operand.source = this->source->substr(expr->start->getStartIndex(), expr->stop->getStopIndex() - expr->start->getStartIndex() + 1);
+
+                entry->chain.operands.push_back(operand);
+                entry->chain.order.push_back(i);
+            }
+        }
+
+        return (this->entries[ctx] = std::move(entry)).get();
+    }
+
+    void Reordering::reorder(Entry& entry) {
+        Chain& chain = entry.chain;
+        vector<double> rank;
+
+        for(const Operand& operand : chain.operands) {
+            double cost = (operand.cost + 1.0) / (operand.evaluated + 1.0);
+            double decides = (operand.decided + 1.0) / (operand.evaluated + 2.0);
+
+            rank.push_back(cost / decides);
+        }
+
+        for(size_t i = 0; i < chain.order.size(); i++) chain.order[i] = i;
+
+        std::stable_sort(chain.order.begin(), chain.order.end(), [&rank](size_t a, size_t b) { return rank[a] < rank[b]; });
+    }
+
+    /* Evaluate a chain in its current order, or return nullptr if it isn't one */
+    VALUE Reordering::eval(LiteExprParser::BinaryOpContext* ctx, Evaluator* evaluator) {
+        Entry* entry = this->find(ctx);
+
+        if(!entry) return nullptr;
+
+        Chain& chain = entry->chain;
+        bool decider = (chain.op == "||");
+        VALUE result;
+
+        if(++chain.evaluations % REORDER_PERIOD == 0 && !chain.fixed) this->reorder(*entry);
+
+        try {
+            for(size_t i : chain.order) {
+                Operand& operand = chain.operands[i];
+                size_t visits = evaluator->visits;
+
+                result = any_cast<VALUE>(evaluator->visit(entry->exprs[i]));
+
+                operand.evaluated++;
+                operand.cost += evaluator->visits - visits;
+
+                if(result->istrue() == decider) {
+                    operand.decided++;
+
+                    break;
+                }
+            }
+        }
+        catch(const InterruptError&) {
+            throw;
+        }
+        catch(const MemoryError&) {
+            throw;
+        }
+        catch(const Error&) {
+            if(std::is_sorted(chain.order.begin(), chain.order.end())) throw;
+
+            for(size_t i = 0; i < chain.order.size(); i++) chain.order[i] = i;
+            chain.fixed = true;
+
+            for(auto expr : entry->exprs) {
+                result = any_cast<VALUE>(evaluator->visit(expr));
+
+                if(result->istrue() == decider) break;
+            }
+        }
+
+        return result;
+    }
+
+    /* The chains in the order they appear in the source */
+    vector<Chain> Reordering::chains() const {
+        vector<pair<size_t,const Chain*> > found;
+        vector<Chain> chains;
+
+        for(const auto& entry : this->entries) {
+            if(entry.second) found.push_back({ entry.second->exprs[0]->start->getStartIndex(), &entry.second->chain });
+        }
+
+        std::sort(found.begin(), found.end());
+
+        for(const auto& chain : found) chains.push_back(*chain.second);
+
+        return chains;
+    }
+
+    Cancellation::Cancellation() {
+        this->cancelled = false;
+    }
+
+    void Cancellation::cancel() {
+        this->cancelled = true;
+    }
+
+    bool Cancellation::isCancelled() const {
+        return this->cancelled;
+    }
+
+    Evaluator::Evaluator(SYMBOLS s, const Limits& limits) {
+        this->symbols = s;
+        this->outer = nullptr;
+        this->limits = limits;
+        this->limited = limits.steps || limits.timeout.count() || limits.cancellation;
+        this->steps = 0;
+        this->deadline = std::chrono::steady_clock::now() + limits.timeout;
+        this->tail = nullptr;
+        this->tailcall = false;
+        this->args = nullptr;
+        this->shared = nullptr;
+        this->reordering = nullptr;
+        this->visits = 0;
+    }
+
+    /* An evaluator for EVAL(), counting against the limits of the outer one */
+    Evaluator::Evaluator(SYMBOLS s, Evaluator* outer): Evaluator(s) {
+        this->outer = outer;
+        this->limited = true;
+    }
+
+    SYMBOLS Evaluator::getSymbols() {
+        return this->symbols;
+    }
+
+    /*
+    * Count a step against the limits, at a call or loop iteration of ctx.
+    * The clock is read every 256 steps.
+    */
+    void Evaluator::tick(antlr4::ParserRuleContext* ctx) {
+        if(!this->limited) return;
+        if(this->outer) return this->outer->tick(ctx);
+
+        this->steps++;
+
+        if(this->limits.steps && this->steps > this->limits.steps) {
+            throw InterruptError("Step limit of " + to_string(this->limits.steps) + " exceeded", ctx->start->getLine(), ctx->start->getCharPositionInLine());
+        }
+
+        if(this->limits.cancellation && this->limits.cancellation->isCancelled()) {
+            throw InterruptError("Evaluation cancelled", ctx->start->getLine(), ctx->start->getCharPositionInLine());
+        }
+
+        if(this->limits.timeout.count() && (this->steps & 0xff) == 0 && std::chrono::steady_clock::now() > this->deadline) {
+            throw InterruptError("Time limit of " + to_string(this->limits.timeout.count()) + "ms exceeded", ctx->start->getLine(), ctx->start->getCharPositionInLine());
+        }
+    }
+
+    /*
+    * Whether the function being entered was called in tail position.  Only
+    * meaningful on entry, before the function evaluates any expression.
+    */
+    bool Evaluator::isTailCall() const {
+        return this->tailcall;
+    }
+
+    /*
+    * Visit an expression whose value becomes the value of the enclosing
+    * function call.  A call found there may return a TailCall to be run by
+    * the caller instead of nesting another frame.
+    */
+    any Evaluator::visitTail(LiteExprParser::ExprContext* ctx) {
+        this->tail = ctx;
+
+        return this->visit(ctx);
+    }
+
+    /* The values of a rule set's shared subexpressions, for one evaluation */
+    struct Evaluator::Shared {
+        const std::unordered_map<antlr4::tree::ParseTree*,size_t>& slots;
+        vector<VALUE> values;
+        size_t evaluated;
+        size_t reused;
+    };
+
+    /*
+    * Shared subexpressions are evaluated once.  Only numbers and strings are
+    * kept, since arrays and objects may be changed by whoever receives them.
+    */
+    any Evaluator::visit(antlr4::tree::ParseTree* tree) {
+        this->visits++;
+
+        if(!this->shared) return tree->accept(this);
+
+        auto slot = this->shared->slots.find(tree);
+
+        if(slot == this->shared->slots.end()) return tree->accept(this);
+
+        VALUE& value = this->shared->values[slot->second];
+
+        if(value) {
+            this->shared->reused++;
+
+            return value;
+        }
+
+        VALUE result = any_cast<VALUE>(tree->accept(this));
+        const type_info& type = result->type();
+
+        this->shared->evaluated++;
+
+        if(!dynamic_pointer_cast<Ident>(result) && (type == typeid(Integer) || type == typeid(Double) || type == typeid(String))) {
+            value = result;
+        }
+
+        return result;
+    }
+
+    Evaluator::Frame::Frame(Evaluator* visitor, SYMBOLS scope) {
+        this->visitor = visitor;
+        this->caller = visitor->symbols;
+        this->tail = visitor->tail;
+        this->args = visitor->args;
+
+        visitor->symbols = scope;
+        visitor->tail = nullptr;
+        visitor->args = nullptr;
+    }
+
+    Evaluator::Frame::~Frame() {
+        this->visitor->symbols = this->caller;
+        this->visitor->tail = this->tail;
+        this->visitor->args = this->args;
+    }
+
+    /*
+    * Call a small closure without a frame of its own.  Its body runs in the
+    * closure's scope with ARG[n] read straight from the argument values.
+    */
+    VALUE Evaluator::inlineCall(FUNCTION fn, vector<LiteExprParser::ExprContext*>& vexpr) {
+        vector<VALUE> args;
+        VALUE result;
+
+        fn->checkArgs(vexpr.size());
+        args.reserve(vexpr.size());
+
+        for(LiteExprParser::ExprContext* expr : vexpr) {
+            args.push_back(any_cast<VALUE>(this->visit(expr)));
+        }
+
+        {
+            Frame frame(this, fn->getScope());
+
+            this->args = &args;
+            result = any_cast<VALUE>(this->visitTail(fn->getStaticExpr()));
+        }
+
+        shared_ptr<TailCall> next = dynamic_pointer_cast<TailCall>(result);
+        if(next) return run_closure(this, next->upscope, next->body, std::move(next->args));
+
+        return result;
+    }
+
+    /*
+    * Where ctx is in the source, for errors.  Without the source, the span is
+    * the text of ctx itself.
+    */
+    Span Evaluator::span(antlr4::ParserRuleContext* ctx) const {
+        Span span;
+
+        if(this->source && ctx->start && ctx->stop) {
+            span.source = this->source;
+            span.start = ctx->start->getStartIndex();
+            span.stop = ctx->stop->getStopIndex() + 1;
+        }
+        else {
+            span.source = std::make_shared<const string>(ctx->getText());
+            span.stop = span.source->size();
+        }
+
+        return span;
+    }
+
+    /*
+    * Give an inlined body the frame it would have had, for callees that may
+    * look at the evaluator's symbols.
+    */
+    void Evaluator::materialize() {
+        SYMBOLS scope(new SymbolTable(this->symbols));
+
+        scope->define("ARG", VALUE(new Array(*this->args)));
+
+        this->symbols = scope;
+        this->args = nullptr;
+    }
+
+    any Evaluator::visitFile(LiteExprParser::FileContext *ctx) {
+        any result = VALUE(new Integer(0));
+
+        if(ctx->expr()) {
+            result = this->visit(ctx->expr());
+        }
+
+        return result;
+    }
+
+    any Evaluator::visitString(LiteExprParser::StringContext *ctx) {
+        if(!this->cache.count(ctx)) {
+            try {
+                this->cache[ctx] = VALUE(new String(String::decode(ctx->STRING()->getText())));
+            }
+            catch(const BasicSyntaxError& e) {
+                throw SyntaxError(e, ctx->start->getLine(), ctx->start->getCharPositionInLine());
+            }
+        }
+
+        return this->cache[ctx];
+    }
+
+    any Evaluator::visitDouble(LiteExprParser::DoubleContext *ctx) {
+        if(!this->cache.count(ctx)) {
+            try {
+                this->cache[ctx] = VALUE(new Double(Double::decode(ctx->DOUBLE()->getText())));
+            }
+            catch(const BasicSyntaxError& e) {
+                throw SyntaxError(e, ctx->start->getLine(), ctx->start->getCharPositionInLine());
+            }
+        }
+
+        return this->cache[ctx];
+    }
+
+    any Evaluator::visitHex(LiteExprParser::HexContext *ctx) {
+        if(!this->cache.count(ctx)) {
+            try {
+                string encoded = ctx->HEX()->getText();
+                this->cache[ctx] = VALUE(new Integer(Integer::decodeHex(encoded.substr(2))));
+            }
+            catch(const BasicSyntaxError& e) {
+                throw SyntaxError(e, ctx->start->getLine(), ctx->start->getCharPositionInLine());
+            }
+        }
+
+        return this->cache[ctx];
+    }
+
+    any Evaluator::visitInt(LiteExprParser::IntContext *ctx) {
+        if(!this->cache.count(ctx)) {
+            try {
+                this->cache[ctx] = VALUE(new Integer(Integer::decode(ctx->INT()->getText())));
+            }
+            catch(const BasicSyntaxError& e) {
+                throw SyntaxError(e, ctx->start->getLine(), ctx->start->getCharPositionInLine());
+            }
+        }
+
+        return this->cache[ctx];
+    }
+
+    any Evaluator::visitArray(LiteExprParser::ArrayContext *ctx) {
+        List result = any_cast<List>(this->visit(ctx->list()));
+
+        return VALUE(new Array(result));
+    }
+
+    any Evaluator::visitObject(LiteExprParser::ObjectContext *ctx) {
+        PairList plist = any_cast<PairList>(this->visit(ctx->pairlist()));
+        map<string,VALUE> result;
+
+        for(const Pair& pi: plist) {
+            string k = pi.first;
+            VALUE v = pi.second;
+
+            result[k] = v;
+        }
+
+        return VALUE(new Object(result));
+    }
+
+    any Evaluator::visitPairlist(LiteExprParser::PairlistContext *ctx) {
+        PairList plist;
+
+        for(LiteExprParser::PairContext* pc: ctx->pair()) {
+            Pair p = any_cast<Pair>(this->visit(pc));
+
+            plist.push_back(p);
+        }
+
+        return plist;
+    }
+
+    any Evaluator::visitPair(LiteExprParser::PairContext *ctx) {
+        string k = ctx->ID()->getText();
+        VALUE v = any_cast<VALUE>(this->visit(ctx->expr()));
+
+        return Pair(k,v);
+    }
+
+    any Evaluator::visitList(LiteExprParser::ListContext *ctx) {
+        List result;
+
+        for(LiteExprParser::ExprContext* expr: ctx->expr()) {
+            result.push_back(any_cast<VALUE>(this->visit(expr)));
+        }
+
+        return result;
+    }
+
+    any Evaluator::visitCall(LiteExprParser::CallContext *ctx) {
+        bool tail = (this->tail == ctx);
+
+        this->tick(ctx);
+
+        VALUE varname = any_cast<VALUE>(this->visit(ctx->varname()));
+        IDENT ident = dynamic_pointer_cast<Ident>(varname);
+        VALUE value = ident->find();
+
+        if(!value) {
+            throw RuntimeError(BasicRuntimeError(ErrorCode::UNKNOWN_SYMBOL, nullptr, ident->getkey()->svalue()), ctx->start->getLine(), ctx->start->getCharPositionInLine());
+        }
+
+        FUNCTION fnname = dynamic_pointer_cast<Function>(value);
+        vector<LiteExprParser::ExprContext*> vexpr = ctx->list()->expr();
+
+        try {
+            if(fnname->isClosure() && !tail) {
+                LiteExprParser::ExprContext* body = fnname->getStaticExpr();
+                auto found = this->inlinable.find(body);
+
+                if(found == this->inlinable.end()) {
+                    int budget = INLINE_BUDGET;
+
+                    found = this->inlinable.emplace(body, is_inlinable(body, budget)).first;
+                }
+
+                if(found->second) return this->inlineCall(fnname, vexpr);
+            }
+            else if(this->args && fnname->isDeferred() && !fnname->isClosure() && !is_builtin(value, "IF")) {
+                this->materialize();
+            }
+
+            this->tailcall = tail;
+
+            VALUE result = fnname->call(vexpr, this);
+
+            return result;
+        }
+        catch(const BasicRuntimeError& e) {
+            throw RuntimeError(e, ctx->start->getLine(), ctx->start->getCharPositionInLine(), this->span(ctx));
+        }
+        catch(const BasicSyntaxError& e) {
+            throw SyntaxError(e, ctx->start->getLine(), ctx->start->getCharPositionInLine(), this->span(ctx));
+        }
+    }
+
+    any Evaluator::visitParen(LiteExprParser::ParenContext *ctx) {
+        if(this->tail == ctx) return this->visitTail(ctx->expr());
+
+        return this->visit(ctx->expr());
+    }
+
+    any Evaluator::visitPrefixOp(LiteExprParser::PrefixOpContext *ctx) {
+        string op = ctx->op->getText();
+        VALUE left = any_cast<VALUE>(this->visit(ctx->varname()));
+        IDENT lvalue = dynamic_pointer_cast<Ident>(left);
+        VALUE result;
+
+        try {
+            if     (op == "++") result = left->op_inc();
+            else if(op == "--") result = left->op_dec();
+            else throw SyntaxError("Unknown prefix operator `" + op + "`", ctx->op->getLine(), ctx->op->getCharPositionInLine());
+        }
+        catch(const BasicRuntimeError& e) {
+            throw RuntimeError(e, ctx->op->getLine(), ctx->op->getCharPositionInLine());
+        }
+
+        lvalue->set(result);
+
+        return left;
+    }
+
+    any Evaluator::visitPostfixOp(LiteExprParser::PostfixOpContext *ctx) {
+        string op = ctx->op->getText();
+        VALUE left = any_cast<VALUE>(this->visit(ctx->varname()));
+        IDENT lvalue = dynamic_pointer_cast<Ident>(left);
+        VALUE last = lvalue->get();
+        VALUE result;
+
+        try {
+            if     (op == "++") result = left->op_inc();
+            else if(op == "--") result = left->op_dec();
+            else throw SyntaxError("Unknown postfix operator `" + op + "`", ctx->op->getLine(), ctx->op->getCharPositionInLine());
+        }
+        catch(const BasicRuntimeError& e) {
+            throw RuntimeError(e, ctx->op->getLine(), ctx->op->getCharPositionInLine());
+        }
+
+        lvalue->set(result);
+
+        return last;
+    }
+
+    any Evaluator::visitUnaryOp(LiteExprParser::UnaryOpContext *ctx) {
+        string op = ctx->op->getText();
+        VALUE value = any_cast<VALUE>(this->visit(ctx->expr()));
+        VALUE result;
+
+        try {
+            if     (op == "!") result = value->op_not();
+            else if(op == "~") result = value->op_inv();
+            else if(op == "+") result = value->op_pos();
+            else if(op == "-") result = value->op_neg();
+            else throw SyntaxError(string("Unknown unary operator `") + op + "`", ctx->op->getLine(), ctx->op->getCharPositionInLine());
+        }
+        catch(const BasicRuntimeError& e) {
+            throw RuntimeError(e, ctx->op->getLine(), ctx->op->getCharPositionInLine());
+        }
+
+        return result;
+    }
+
+    any Evaluator::visitBinaryOp(LiteExprParser::BinaryOpContext *ctx) {
+        bool tail = (this->tail == ctx);
+        string op = ctx->op->getText();
+
+        if(this->reordering && (op == "&&" || op == "||")) {
+            VALUE result = this->reordering->eval(ctx, this);
+
+            if(result) return result;
+        }
+
+        VALUE left = any_cast<VALUE>(this->visit(ctx->expr(0)));
+        LiteExprParser::ExprContext* rexpr = ctx->expr(1);
+        VALUE result;
+
+        try {
+            if     (op == "**")  result = left->op_pow(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "*")   result = left->op_mul(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "/")   result = left->op_div(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "%")   result = left->op_mod(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "+")   result = left->op_add(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "-")   result = left->op_sub(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "<<")  result = left->op_shl(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == ">>")  result = left->op_asr(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == ">>>") result = left->op_shr(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "<")   result = left->op_lt(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == ">")   result = left->op_gt(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "==")  result = left->op_eq(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "!=")  result = left->op_ne(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "<=")  result = left->op_lte(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == ">=")  result = left->op_gte(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "|")   result = left->op_or(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "^")   result = left->op_xor(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "&")   result = left->op_and(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "||")  result = left->istrue() ? left : any_cast<VALUE>(this->visit(rexpr));
+            else if(op == "&&")  result = left->istrue() ? any_cast<VALUE>(this->visit(rexpr)) : left;
+            else if(op == ";")   result = any_cast<VALUE>(tail ? this->visitTail(rexpr) : this->visit(rexpr));
+            else throw SyntaxError("Unknown binary operator `" + op + "`", ctx->op->getLine(), ctx->op->getCharPositionInLine());
+        }
+        catch(const BasicRuntimeError& e) {
+            throw RuntimeError(e, ctx->op->getLine(), ctx->op->getCharPositionInLine());
+        }
+
+        return result;
+    }
+
+    any Evaluator::visitTernaryOp(LiteExprParser::TernaryOpContext *ctx) {
+        bool tail = (this->tail == ctx);
+        string op1 = ctx->op1->getText();
+        string op2 = ctx->op2->getText();
+        VALUE left = any_cast<VALUE>(this->visit(ctx->expr(0)));
+        LiteExprParser::ExprContext* expr1 = ctx->expr(1);
+        LiteExprParser::ExprContext* expr2 = ctx->expr(2);
+        VALUE result;
+
+        try {
+            if (op1 == "?" && op2 == ":") {
+                LiteExprParser::ExprContext* branch = left->istrue() ? expr1 : expr2;
+
+                result = any_cast<VALUE>(tail ? this->visitTail(branch) : this->visit(branch));
+            }
+            else throw SyntaxError("Unknown ternary operator `" + op1 + " " + op2 + "`", ctx->op1->getLine(), ctx->op1->getCharPositionInLine());
+        }
+        catch(const BasicRuntimeError& e) {
+            throw RuntimeError(e, ctx->op1->getLine(), ctx->op1->getCharPositionInLine());
+        }
+
+        return result;
+    }
+
+    any Evaluator::visitAssignOp(LiteExprParser::AssignOpContext *ctx) {
+        string op = ctx->op->getText();
+        VALUE left = any_cast<VALUE>(this->visit(ctx->varname()));
+        IDENT lvalue = dynamic_pointer_cast<Ident>(left);
+        antlr4::tree::ParseTree* rexpr = ctx->expr();
+        VALUE result;
+
+        try {
+            if     (op == "=")    result = any_cast<VALUE>(this->visit(rexpr));
+            else if(op == "**=")  result = left->op_pow(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "*=")   result = left->op_mul(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "/=")   result = left->op_div(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "%=")   result = left->op_mod(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "+=")   result = left->op_add(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "-=")   result = left->op_sub(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "<<=")  result = left->op_shl(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == ">>=")  result = left->op_asr(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == ">>>=") result = left->op_shr(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "|=")   result = left->op_or(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "^=")   result = left->op_xor(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "&=")   result = left->op_and(any_cast<VALUE>(this->visit(rexpr)));
+            else if(op == "||=")  result = left->istrue() ? lvalue->get() : any_cast<VALUE>(this->visit(rexpr));
+            else if(op == "&&=")  result = left->istrue() ? any_cast<VALUE>(this->visit(rexpr)) : lvalue->get();
+            else throw SyntaxError("Unknown assignment operator `" + op + "`", ctx->op->getLine(), ctx->op->getCharPositionInLine());
+        }
+        catch(const BasicRuntimeError& e) {
+            throw RuntimeError(e, ctx->op->getLine(), ctx->op->getCharPositionInLine());
+        }
+
+        lvalue->set(result);
+
+        return left;
+    }
+
+    any Evaluator::visitVariable(LiteExprParser::VariableContext *ctx) {
+        return this->visit(ctx->varname());
+    }
+
+    any Evaluator::visitMemberVar(LiteExprParser::MemberVarContext *ctx) {
+        IDENT name = dynamic_pointer_cast<Ident>(any_cast<VALUE>(this->visit(ctx->varname(0))));
+        IDENT value = dynamic_pointer_cast<Ident>(any_cast<VALUE>(this->visit(ctx->varname(1))));
+
+        return VALUE(new Ident(name->get(), value->getkey()));
+    }
+
+    any Evaluator::visitIndexedVar(LiteExprParser::IndexedVarContext *ctx) {
+        auto base = this->args ? dynamic_cast<LiteExprParser::SimpleVarContext*>(ctx->varname()) : nullptr;
+
+        /* ARG[n] of an inlined call; only read as a value is it not wrapped in an Ident */
+        if(base && base->ID()->getText() == "ARG") {
+            VALUE index = any_cast<VALUE>(this->visit(ctx->expr()));
+            bool read = dynamic_cast<LiteExprParser::VariableContext*>(ctx->parent);
+
+            if(read && index->type() == typeid(Integer) && 0 <= index->ivalue() && index->ivalue() < this->args->size()) {
+                return (*this->args)[index->ivalue()];
+            }
+
+            return VALUE(new Ident(VALUE(new Array(*this->args)), index));
+        }
+
+        IDENT name = dynamic_pointer_cast<Ident>(any_cast<VALUE>(this->visit(ctx->varname())));
+        VALUE value = any_cast<VALUE>(this->visit(ctx->expr()));
+
+        return VALUE(new Ident(name->get(), value));
+    }
+
+    any Evaluator::visitSimpleVar(LiteExprParser::SimpleVarContext *ctx) {
+        string name = ctx->ID()->getText();
+
+        return VALUE(new Ident(this->symbols, VALUE(new String(name))));
+    }
+
+    any Evaluator::visitTerm(LiteExprParser::TermContext *ctx) {
+        if(this->tail == ctx) return this->visitTail(ctx->expr());
+
+        return this->visit(ctx->expr());
+    }
+
+
+    /* ***************************************************************************
+    * MAPPED FILE
+    */
+
+    /*
+    * A file mapped read-only into memory.  An empty file maps to nothing.
+    */
+    class MappedFile {
+        void* mapping;
+
+        public:
+            const char* data;
+            uint64_t size;
+
+            MappedFile(const string& path, const char* what);
+            MappedFile(const MappedFile&) = delete;
+            ~MappedFile();
+    };
+
+    MappedFile::MappedFile(const string& path, const char* what) {
+        struct stat st;
+        int fd = open(path.c_str(), O_RDONLY);
+
+        this->mapping = MAP_FAILED;
+        this->data = nullptr;
+        this->size = 0;
+
+        if(fd < 0 || fstat(fd, &st) != 0) {
+            if(fd >= 0) close(fd);
+
+            throw BasicRuntimeError(string("Unable to read ") + what + ": " + path);
+        }
+
+        if(st.st_size > 0) {
+            this->mapping = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        }
+
+        close(fd);
+
+        if(this->mapping != MAP_FAILED) {
+            this->data = static_cast<const char*>(this->mapping);
+            this->size = st.st_size;
+        }
+        else if(st.st_size > 0) {
+            throw BasicRuntimeError(string("Unable to read ") + what + ": " + path);
+        }
+    }
+
+    MappedFile::~MappedFile() {
+        if(this->mapping != MAP_FAILED) munmap(this->mapping, this->size);
+    }
+
+
+    /* ***************************************************************************
+    * RESULT CACHE
+    */
+
+    /* The names in a path */
+    static vector<string> path_names(const string& path) {
+        vector<string> names;
+        size_t start = 0;
+        size_t dot;
+
+        while((dot = path.find('.', start)) != string::npos) {
+            names.push_back(path.substr(start, dot - start));
+            start = dot + 1;
+        }
+
+        names.push_back(path.substr(start));
+
+        return names;
+    }
+
+    /* The value at a path, or nullptr if there is none */
+    static VALUE path_value(SYMBOLS symbols, const vector<string>& names) {
+        VALUE value = symbols->find(names[0]);
+
+        for(size_t i = 1; value && i < names.size(); i++) {
+            value = resolved(value);
+
+            if(auto object = dynamic_pointer_cast<Object>(value)) value = object->find(names[i]);
+            else if(auto view = dynamic_pointer_cast<ObjectView>(value)) value = view->find(names[i]);
+            else value = nullptr;
+        }
+
+        return value;
+    }
+
+    /*
+    * The results of a pure program, by the values of what it reads.  A key is
+    * those values written out whole, type and all, so equal keys mean equal
+    * inputs.  Only numbers and strings are kept, since arrays and objects may
+    * be changed by whoever receives them.  Entries are dropped least recently
+    * used first, and once they are older than the time to live, if any.
+    * Host functions the program calls must be pure for it to be cached, and
+    * which ones are bound is part of the key.  Entries hold on to them, so
+    * the address of one can't be reused by another while it is a key.
+    */
+    class ResultCache {
+        struct Entry {
+            VALUE result;
+            std::chrono::steady_clock::time_point added;
+            std::list<const string*>::iterator used;
+            vector<VALUE> functions;
+        };
+
+        vector<vector<string> > inputs;
+        vector<vector<string> > functions;
+        size_t capacity;
+        std::chrono::milliseconds ttl;
+        std::unordered_map<string,Entry> entries;
+        std::list<const string*> recent;
+        Caching caching;
+
+        static void put(string& key, const void* data, size_t size);
+
+        public:
+            ResultCache(const std::set<string>& reads, const std::set<string>& functions, size_t capacity, std::chrono::milliseconds ttl);
+            static void fingerprint(string& key, VALUE value, vector<const Value*>& containers);
+            bool key(SYMBOLS symbols, string& key, vector<VALUE>& functions) const;
+            VALUE find(const string& key);
+            void insert(const string& key, VALUE result, vector<VALUE> functions={});
+            Caching stats() const;
+    };
+
+    ResultCache::ResultCache(const std::set<string>& reads, const std::set<string>& functions, size_t capacity, std::chrono::milliseconds ttl) {
+        for(const string& path : reads) this->inputs.push_back(path_names(path));
+        for(const string& path : functions) this->functions.push_back(path_names(path));
+
+        this->capacity = capacity;
+        this->ttl = ttl;
+    }
+
+    void ResultCache::put(string& key, const void* data, size_t size) {
+        key.append(static_cast<const char*>(data), size);
+    }
+
+    /* A container already being written is a cycle, written as its place */
+    void ResultCache::fingerprint(string& key, VALUE value, vector<const Value*>& containers) {
+        value = resolved(value);
+
+        if(!value) {
+            key += 'u';
+            return;
+        }
+
+        if(value->type() == typeid(Integer)) {
+            int64_t number = value->ivalue();
+
+            key += 'i';
+            put(key, &number, sizeof(number));
+            return;
+        }
+
+        if(value->type() == typeid(Double)) {
+            double number = value->dvalue();
+
+            key += 'd';
+            put(key, &number, sizeof(number));
+            return;
+        }
+
+        if(value->type() == typeid(String)) {
+            string text = value->svalue();
+            uint64_t size = text.size();
+
+            key += 's';
+            put(key, &size, sizeof(size));
+            key += text;
+            return;
+        }
+
+        auto array = dynamic_pointer_cast<Array>(value);
+        auto arrayView = dynamic_pointer_cast<ArrayView>(value);
+        auto object = dynamic_pointer_cast<Object>(value);
+        auto objectView = dynamic_pointer_cast<ObjectView>(value);
+
+        if(!array && !arrayView && !object && !objectView) {
+            const Value* identity = value.get();
+
+            key += 'p';
+            put(key, &identity, sizeof(identity));
+            return;
+        }
+
+        auto open = std::find(containers.begin(), containers.end(), value.get());
+        uint64_t size = value->length();
+
+        if(open != containers.end()) {
+            uint64_t depth = open - containers.begin();
+
+            key += 'c';
+            put(key, &depth, sizeof(depth));
+            return;
+        }
+
+        containers.push_back(value.get());
+        key += (array || arrayView) ? 'a' : 'o';
+        put(key, &size, sizeof(size));
+
+        if(array) {
+            for(const VALUE& element : array->avalue()) fingerprint(key, element, containers);
+        }
+        else if(arrayView) {
+            for(int64_t i = 0; i < size; i++) fingerprint(key, arrayView->find(i), containers);
+        }
+        else {
+            for(const auto& member : object ? object->ovalue() : objectView->members()) {
+                uint64_t length = member.first.size();
+
+                put(key, &length, sizeof(length));
+                key += member.first;
+                fingerprint(key, member.second, containers);
+            }
+        }
+
+        containers.pop_back();
+    }
+
+    /* The functions the program calls and the values of the symbols and
+    * member paths it reads, unless a function it calls isn't pure.  Built-ins
+    * are only trusted if the host hasn't replaced them. */
+    bool ResultCache::key(SYMBOLS symbols, string& key, vector<VALUE>& functions) const {
+        vector<const Value*> containers;
+
+        for(const vector<string>& names : this->functions) {
+            VALUE value = resolved(path_value(symbols, names));
+            FUNCTION function = dynamic_pointer_cast<Function>(value);
+            const Value* identity = value.get();
+
+            if(names.size() == 1 && (names[0] == "IF" || PURE_BUILTINS.count(names[0])) && is_builtin(value, names[0])) continue;
+            if(!function || !function->isPure()) return false;
+
+            key += 'f';
+            put(key, &identity, sizeof(identity));
+            functions.push_back(value);
+        }
+
+        for(const vector<string>& names : this->inputs) {
+            fingerprint(key, path_value(symbols, names), containers);
+        }
+
+        return true;
+    }
+
+    VALUE ResultCache::find(const string& key) {
+        auto found = this->entries.find(key);
+
+        if(found != this->entries.end() && this->ttl.count() && std::chrono::steady_clock::now() - found->second.added >= this->ttl) {
+            this->recent.erase(found->second.used);
+            this->entries.erase(found);
+            this->caching.expired++;
+
+            found = this->entries.end();
+        }
+
+        if(found == this->entries.end()) {
+            this->caching.misses++;
+
+            return nullptr;
+        }
+
+        this->recent.splice(this->recent.begin(), this->recent, found->second.used);
+        this->caching.hits++;
+
+        return found->second.result;
+    }
+
+    void ResultCache::insert(const string& key, VALUE result, vector<VALUE> functions) {
+        result = resolved(result);
+
+        if(result->type() != typeid(Integer) && result->type() != typeid(Double) && result->type() != typeid(String)) return;
+
+        if(this->entries.count(key)) return;
+
+        if(this->entries.size() >= this->capacity) {
+            this->entries.erase(*this->recent.back());
+            this->recent.pop_back();
+            this->caching.evicted++;
+        }
+
+        auto added = this->entries.emplace(key, Entry{ result, std::chrono::steady_clock::now(), this->recent.end(), std::move(functions) }).first;
+
+        this->recent.push_front(&added->first);
+        added->second.used = this->recent.begin();
+    }
+
+    Caching ResultCache::stats() const {
+        Caching caching = this->caching;
+
+        caching.entries = this->entries.size();
+
+        return caching;
+    }
+
+
+    /* ***************************************************************************
+    * COMPILED
+    */
+
+    /*
+    * A compiled file holds a program's source and its parse tree, so the tree
+    * can be rebuilt without lexing or parsing.  It is a header of magic,
+    * version, byte order and checksum, then the source, the tokens and the
+    * nodes of the tree.  Numbers are 64-bit words in the byte order of the
+    * machine that wrote the file; the checksum covers everything after it.
+    *
+    *   source   length, bytes
+    *   tokens   count, (type, line, column, start, stop, length, text)...
+    *   nodes    count, node...
+    *
+    * Nodes are in prefix order.  A terminal is its kind and its token; a rule
+    * is its kind, child count, start and stop tokens, and its operators.  The
+    * header and source are laid out the same in every version, so a file
+    * written by another version is compiled again from its source.
+    */
+    static const char COMPILED_MAGIC[8] = { 'L', 'E', 'C', 'O', 'M', 'P', 'I', 'L' };
+    static const uint64_t COMPILED_VERSION = 1;
+    static const uint64_t COMPILED_ORDER = 0x0102030405060708;
+    static const uint64_t COMPILED_HEADER = 4 * 8;
+    static const uint64_t COMPILED_NONE = ~uint64_t(0);
+
+    template<typename T> static antlr4::ParserRuleContext* make_rule() {
+        return new T(nullptr, 0);
+    }
+
+    template<typename T, typename Rule> static antlr4::ParserRuleContext* make_alternative() {
+        Rule rule;
+
+        return new T(&rule);
+    }
+
+    /*
+    * The kinds of node, numbered from 1; 0 is a terminal.  The shape is the
+    * children the grammar gives each kind: e an expr, v a varname, l a list,
+    * P a pairlist, p a pair, t any terminal, S D H I N the STRING, DOUBLE,
+    * HEX, INT and ID terminals, and $ the end of file.  A ? makes the child
+    * before it optional, and a trailing , repeats the child before it with a
+    * terminal between each.
+    */
+    static const struct {
+        const type_info& type;
+        antlr4::ParserRuleContext* (*make)();
+        const char* shape;
+    } NODE_KINDS[] = {
+        { typeid(LiteExprParser::FileContext)       , make_rule<LiteExprParser::FileContext>                                              , "e?$" },
+        { typeid(LiteExprParser::StringContext)     , make_alternative<LiteExprParser::StringContext, LiteExprParser::ExprContext>        , "S" },
+        { typeid(LiteExprParser::DoubleContext)     , make_alternative<LiteExprParser::DoubleContext, LiteExprParser::ExprContext>        , "D" },
+        { typeid(LiteExprParser::HexContext)        , make_alternative<LiteExprParser::HexContext, LiteExprParser::ExprContext>           , "H" },
+        { typeid(LiteExprParser::IntContext)        , make_alternative<LiteExprParser::IntContext, LiteExprParser::ExprContext>           , "I" },
+        { typeid(LiteExprParser::ParenContext)      , make_alternative<LiteExprParser::ParenContext, LiteExprParser::ExprContext>         , "tet" },
+        { typeid(LiteExprParser::CallContext)       , make_alternative<LiteExprParser::CallContext, LiteExprParser::ExprContext>          , "vtlt" },
+        { typeid(LiteExprParser::VariableContext)   , make_alternative<LiteExprParser::VariableContext, LiteExprParser::ExprContext>      , "v" },
+        { typeid(LiteExprParser::ObjectContext)     , make_alternative<LiteExprParser::ObjectContext, LiteExprParser::ExprContext>        , "tPt" },
+        { typeid(LiteExprParser::ArrayContext)      , make_alternative<LiteExprParser::ArrayContext, LiteExprParser::ExprContext>         , "tlt" },
+        { typeid(LiteExprParser::PostfixOpContext)  , make_alternative<LiteExprParser::PostfixOpContext, LiteExprParser::ExprContext>     , "vt" },
+        { typeid(LiteExprParser::PrefixOpContext)   , make_alternative<LiteExprParser::PrefixOpContext, LiteExprParser::ExprContext>      , "tv" },
+        { typeid(LiteExprParser::UnaryOpContext)    , make_alternative<LiteExprParser::UnaryOpContext, LiteExprParser::ExprContext>       , "te" },
+        { typeid(LiteExprParser::BinaryOpContext)   , make_alternative<LiteExprParser::BinaryOpContext, LiteExprParser::ExprContext>      , "ete" },
+        { typeid(LiteExprParser::AssignOpContext)   , make_alternative<LiteExprParser::AssignOpContext, LiteExprParser::ExprContext>      , "vte" },
+        { typeid(LiteExprParser::TernaryOpContext)  , make_alternative<LiteExprParser::TernaryOpContext, LiteExprParser::ExprContext>     , "etete" },
+        { typeid(LiteExprParser::TermContext)       , make_alternative<LiteExprParser::TermContext, LiteExprParser::ExprContext>          , "et" },
+        { typeid(LiteExprParser::MemberVarContext)  , make_alternative<LiteExprParser::MemberVarContext, LiteExprParser::VarnameContext>  , "vtv" },
+        { typeid(LiteExprParser::IndexedVarContext) , make_alternative<LiteExprParser::IndexedVarContext, LiteExprParser::VarnameContext> , "vtet" },
+        { typeid(LiteExprParser::SimpleVarContext)  , make_alternative<LiteExprParser::SimpleVarContext, LiteExprParser::VarnameContext>  , "N" },
+        { typeid(LiteExprParser::PairlistContext)   , make_rule<LiteExprParser::PairlistContext>                                          , "p," },
+        { typeid(LiteExprParser::PairContext)       , make_rule<LiteExprParser::PairContext>                                              , "Nte" },
+        { typeid(LiteExprParser::ListContext)       , make_rule<LiteExprParser::ListContext>                                              , "e," },
+    };
+
+    /* The operator tokens of a rule */
+    static vector<antlr4::Token**> operators(antlr4::ParserRuleContext* ctx) {
+        if(auto op = dynamic_cast<LiteExprParser::PostfixOpContext*>(ctx)) return { &op->op };
+        if(auto op = dynamic_cast<LiteExprParser::PrefixOpContext*>(ctx))  return { &op->op };
+        if(auto op = dynamic_cast<LiteExprParser::UnaryOpContext*>(ctx))   return { &op->op };
+        if(auto op = dynamic_cast<LiteExprParser::BinaryOpContext*>(ctx))  return { &op->op };
+        if(auto op = dynamic_cast<LiteExprParser::AssignOpContext*>(ctx))  return { &op->op };
+        if(auto op = dynamic_cast<LiteExprParser::TernaryOpContext*>(ctx)) return { &op->op1, &op->op2 };
+
+        return {};
+    }
+
+    /* Whether a child is what a shape letter asks for */
+    static bool is_shaped(antlr4::tree::ParseTree* child, char letter) {
+        auto terminal = dynamic_cast<antlr4::tree::TerminalNode*>(child);
+        size_t type = terminal ? terminal->getSymbol()->getType() : 0;
+
+        switch(letter) {
+            case 'e': return dynamic_cast<LiteExprParser::ExprContext*>(child);
+            case 'v': return dynamic_cast<LiteExprParser::VarnameContext*>(child);
+            case 'l': return dynamic_cast<LiteExprParser::ListContext*>(child);
+            case 'P': return dynamic_cast<LiteExprParser::PairlistContext*>(child);
+            case 'p': return dynamic_cast<LiteExprParser::PairContext*>(child);
+            case 't': return terminal;
+            case 'S': return terminal && type == LiteExprParser::STRING;
+            case 'D': return terminal && type == LiteExprParser::DOUBLE;
+            case 'H': return terminal && type == LiteExprParser::HEX;
+            case 'I': return terminal && type == LiteExprParser::INT;
+            case 'N': return terminal && type == LiteExprParser::ID;
+            case '$': return terminal && type == antlr4::Token::EOF;
+        }
+
+        return false;
+    }
+
+    /* Whether a rule's children are the shape the grammar gives it */
+    static bool is_shaped(antlr4::ParserRuleContext* ctx, const char* shape) {
+        const vector<antlr4::tree::ParseTree*>& children = ctx->children;
+        size_t i = 0;
+
+        if(shape[0] && shape[1] == ',') {
+            for(; i < children.size(); i++) {
+                if(!is_shaped(children[i], i % 2 ? 't' : shape[0])) return false;
+            }
+
+            return true;
+        }
+
+        for(; *shape; shape++) {
+            bool optional = (shape[1] == '?');
+
+            if(i < children.size() && is_shaped(children[i], *shape)) i++;
+            else if(!optional) return false;
+
+            if(optional) shape++;
+        }
+
+        return i == children.size();
+    }
+
+    /* FNV-1a */
+    static uint64_t checksum(const char* data, size_t size) {
+        uint64_t hash = 0xcbf29ce484222325;
+
+        for(size_t i = 0; i < size; i++) {
+            hash ^= static_cast<unsigned char>(data[i]);
+            hash *= 0x100000001b3;
+        }
+
+        return hash;
+    }
+
+    static uint64_t byteswap(uint64_t word) {
+        uint64_t swapped = 0;
+
+        for(int i = 0; i < 8; i++) swapped = (swapped << 8) | ((word >> (i * 8)) & 0xff);
+
+        return swapped;
+    }
+
+    class TreeWriter {
+        std::unordered_map<const antlr4::Token*,uint64_t> numbers;
+        vector<const antlr4::Token*> tokens;
+        string nodes;
+        uint64_t count = 0;
+
+        static void put(string& out, uint64_t word);
+        uint64_t number(const antlr4::Token* token);
+        void node(antlr4::tree::ParseTree* node);
+
+        public:
+            string write(const string& source, antlr4::tree::ParseTree* tree);
+    };
+
+    void TreeWriter::put(string& out, uint64_t word) {
+        out.append(reinterpret_cast<const char*>(&word), sizeof(word));
+    }
+
+    uint64_t TreeWriter::number(const antlr4::Token* token) {
+        if(!token) return COMPILED_NONE;
+
+        auto found = this->numbers.emplace(token, this->tokens.size());
+
+        if(found.second) this->tokens.push_back(token);
+
+        return found.first->second;
+    }
+
+    void TreeWriter::node(antlr4::tree::ParseTree* node) {
+        this->count++;
+
+        if(auto terminal = dynamic_cast<antlr4::tree::TerminalNode*>(node)) {
+            put(this->nodes, 0);
+            put(this->nodes, this->number(terminal->getSymbol()));
+
+            return;
+        }
+
+        auto ctx = dynamic_cast<antlr4::ParserRuleContext*>(node);
+        uint64_t kind = 0;
+
+        while(ctx && kind < std::size(NODE_KINDS) && NODE_KINDS[kind].type != typeid(*ctx)) kind++;
+
+        if(!ctx || kind == std::size(NODE_KINDS)) throw BasicRuntimeError("Unable to save an incomplete parse tree");
+
+        put(this->nodes, kind + 1);
+        put(this->nodes, ctx->children.size());
+        put(this->nodes, this->number(ctx->start));
+        put(this->nodes, this->number(ctx->stop));
+
+        for(antlr4::Token** op : operators(ctx)) put(this->nodes, this->number(*op));
+        for(antlr4::tree::ParseTree* child : ctx->children) this->node(child);
+    }
+
+    string TreeWriter::write(const string& source, antlr4::tree::ParseTree* tree) {
+        string out(COMPILED_MAGIC, sizeof(COMPILED_MAGIC));
+
+        this->node(tree);
+
+        put(out, COMPILED_VERSION);
+        put(out, COMPILED_ORDER);
+        put(out, 0);
+        put(out, source.size());
+        out += source;
+        put(out, this->tokens.size());
+
+        for(const antlr4::Token* token : this->tokens) {
+            string text = token->getText();
+
+            put(out, token->getType());
+            put(out, token->getLine());
+            put(out, token->getCharPositionInLine());
+            put(out, token->getStartIndex());
+            put(out, token->getStopIndex());
+            put(out, text.size());
+            out += text;
+        }
+
+        put(out, this->count);
+        out += this->nodes;
+
+        uint64_t sum = checksum(out.data() + COMPILED_HEADER, out.size() - COMPILED_HEADER);
+
+        memcpy(&out[COMPILED_HEADER - 8], &sum, sizeof(sum));
+
+        return out;
+    }
+
+    /*
+    * Rebuilds a parse tree from a compiled file.  The tokens and nodes it
+    * makes are owned by the Compiled it is reading for.  A tree that isn't
+    * the shape the grammar gives is read as null, to be compiled again.
+    */
+    class TreeReader {
+        const char* p;
+        const char* end;
+        const string& path;
+        vector<antlr4::Token*> tokens;
+        vector<std::unique_ptr<antlr4::Token> >& ownedTokens;
+        vector<std::unique_ptr<antlr4::tree::ParseTree> >& ownedNodes;
+        bool misshapen = false;
+
+        [[noreturn]] void invalid() const;
+        uint64_t word();
+        std::string_view bytes(uint64_t size);
+        antlr4::Token* token();
+        antlr4::tree::ParseTree* node(antlr4::tree::ParseTree* parent);
+
+        public:
+            TreeReader(const char* data, uint64_t size, const string& path, vector<std::unique_ptr<antlr4::Token> >& tokens, vector<std::unique_ptr<antlr4::tree::ParseTree> >& nodes);
+            antlr4::ParserRuleContext* read();
+    };
+
+    TreeReader::TreeReader(const char* data, uint64_t size, const string& path, vector<std::unique_ptr<antlr4::Token> >& tokens, vector<std::unique_ptr<antlr4::tree::ParseTree> >& nodes): path(path), ownedTokens(tokens), ownedNodes(nodes) {
+        this->p = data;
+        this->end = data + size;
+    }
+
+    void TreeReader::invalid() const {
+        throw BasicRuntimeError("Invalid compiled file: " + this->path);
+    }
+
+    uint64_t TreeReader::word() {
+        uint64_t w;
+
+        if(this->end - this->p < 8) this->invalid();
+
+        memcpy(&w, this->p, sizeof(w));
+        this->p += sizeof(w);
+
+        return w;
+    }
+
+    std::string_view TreeReader::bytes(uint64_t size) {
+        if(uint64_t(this->end - this->p) < size) this->invalid();
+
+        std::string_view v(this->p, size);
+
+        this->p += size;
+
+        return v;
+    }
+
+    antlr4::Token* TreeReader::token() {
+        uint64_t n = this->word();
+
+        if(n == COMPILED_NONE) return nullptr;
+        if(n >= this->tokens.size()) this->invalid();
+
+        return this->tokens[n];
+    }
+
+    antlr4::tree::ParseTree* TreeReader::node(antlr4::tree::ParseTree* parent) {
+        uint64_t kind = this->word();
+        antlr4::tree::ParseTree* node;
+
+        if(kind == 0) {
+            antlr4::Token* token = this->token();
+
+            if(!token) this->invalid();
+
+            node = new antlr4::tree::TerminalNodeImpl(token);
+            this->ownedNodes.emplace_back(node);
+        }
+        else if(kind <= std::size(NODE_KINDS)) {
+            antlr4::ParserRuleContext* ctx = NODE_KINDS[kind-1].make();
+            uint64_t children;
+
+            this->ownedNodes.emplace_back(ctx);
+
+            children = this->word();
+            ctx->start = this->token();
+            ctx->stop = this->token();
+
+            for(antlr4::Token** op : operators(ctx)) *op = this->token();
+
+            for(uint64_t i = 0; i < children; i++) {
+                ctx->children.push_back(this->node(ctx));
+            }
+
+            /* An empty list or pairlist may have no tokens of its own */
+            if(!ctx->children.empty() && (!ctx->start || !ctx->stop)) this->misshapen = true;
+            if(!is_shaped(ctx, NODE_KINDS[kind-1].shape)) this->misshapen = true;
+
+            for(antlr4::Token** op : operators(ctx)) {
+                if(!*op) this->misshapen = true;
+            }
+
+            node = ctx;
+        }
+        else {
+            this->invalid();
+        }
+
+        node->parent = parent;
+
+        return node;
+    }
+
+    antlr4::ParserRuleContext* TreeReader::read() {
+        uint64_t count = this->word();
+
+        this->ownedTokens.reserve(count);
+        this->tokens.reserve(count);
+
+        for(uint64_t i = 0; i < count; i++) {
+            uint64_t type = this->word();
+            uint64_t line = this->word();
+            uint64_t col = this->word();
+            uint64_t start = this->word();
+            uint64_t stop = this->word();
+            std::string_view text = this->bytes(this->word());
+            auto token = std::make_unique<antlr4::CommonToken>(type, string(text));
+
+            token->setLine(line);
+            token->setCharPositionInLine(col);
+            token->setStartIndex(start);
+            token->setStopIndex(stop);
+            token->setTokenIndex(i);
+
+            this->tokens.push_back(token.get());
+            this->ownedTokens.push_back(std::move(token));
+        }
+
+        count = this->word();
+
+        if(count > uint64_t(this->end - this->p) / 16) this->invalid();
+
+        this->ownedNodes.reserve(count);
+
+        antlr4::ParserRuleContext* tree = dynamic_cast<antlr4::ParserRuleContext*>(this->node(nullptr));
+
+        if(!tree || this->p != this->end || this->ownedNodes.size() != count) this->invalid();
+
+        return this->misshapen ? nullptr : tree;
+    }
+
+    Compiled::Compiled(string expr) {
+        this->source = std::make_shared<const string>(expr);
+        this->parse();
+    }
+
+    /* Load a compiled file, or compile its source if it was written by
+    * another version or its tree isn't one the grammar makes */
+    Compiled::Compiled(Path path) {
+        MappedFile file(path.path, "compiled file");
+        uint64_t header[4];
+
+        this->input = nullptr;
+        this->tokens = nullptr;
+        this->lexer = nullptr;
+        this->parser = nullptr;
+
+        if(file.size < COMPILED_HEADER + 8 || memcmp(file.data, COMPILED_MAGIC, sizeof(COMPILED_MAGIC)) != 0) {
+            throw BasicRuntimeError("Invalid compiled file: " + path.path);
+        }
+
+        memcpy(header, file.data, sizeof(header));
+
+        bool swapped = (header[2] != COMPILED_ORDER);
+        uint64_t sum = swapped ? byteswap(header[3]) : header[3];
+        uint64_t length;
+
+        if(sum != checksum(file.data + COMPILED_HEADER, file.size - COMPILED_HEADER)) {
+            throw BasicRuntimeError("Invalid compiled file: " + path.path);
+        }
+
+        memcpy(&length, file.data + COMPILED_HEADER, sizeof(length));
+        if(swapped) length = byteswap(length);
+
+        if(length > file.size - COMPILED_HEADER - 8) throw BasicRuntimeError("Invalid compiled file: " + path.path);
+
+        this->source = std::make_shared<const string>(file.data + COMPILED_HEADER + 8, length);
+
+        if(swapped || header[1] != COMPILED_VERSION) {
+            this->parse();
+        }
+        else {
+            uint64_t offset = COMPILED_HEADER + 8 + length;
+
+            this->parseTree = TreeReader(file.data + offset, file.size - offset, path.path, this->loadedTokens, this->loadedNodes).read();
+
+            if(!this->parseTree) {
+                this->loadedNodes.clear();
+                this->loadedTokens.clear();
+                this->parse();
+            }
+        }
+    }
+
+    void Compiled::parse() {
+        this->input = new antlr4::ANTLRInputStream(*this->source);
+        this->lexer = new LiteExprLexer(this->input);
+
+        this->tokens = new antlr4::CommonTokenStream(this->lexer);
+        this->parser = new LiteExprParser(this->tokens);
+
+        this->parser->setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+
+        try {
+            this->parseTree = this->parser->file();
+        }
+        catch(antlr4::ParseCancellationException e) {
+            const antlr4::Token* token = this->parser->getCurrentToken();
+            string message = string("Unexpected token `") + token->getText() + "`";
+            int line = token->getLine();
+            int col = token->getCharPositionInLine();
+
+            throw SyntaxError(message, line, col);
+        }
+    }
+
+    Compiled::~Compiled() {
+        if(this->parser) delete(this->parser);
+        if(this->tokens) delete(this->tokens);
+        if(this->lexer) delete(this->lexer);
+        if(this->input) delete(this->input);
+
+        this->parser = nullptr;
+        this->tokens = nullptr;
+        this->lexer = nullptr;
+        this->input = nullptr;
+    }
+
+    VALUE Compiled::eval(SYMBOLS symbols, const Limits& limits) {
+        string key;
+        vector<VALUE> functions;
+        bool cacheable = this->results && this->results->key(symbols, key, functions);
+        VALUE cached = cacheable ? this->results->find(key) : nullptr;
+
+        if(cached) return cached;
+
+        std::unique_ptr<Meter> metered(limits.memory || limits.usage ? new Meter(limits) : nullptr);
+        Evaluator evaluator(symbols, limits);
+
+        evaluator.source = this->source;
+        evaluator.reordering = this->reordering.get();
+
+        VALUE result = any_cast<VALUE>(evaluator.visit(this->parseTree));
+
+        if(cacheable) this->results->insert(key, result, std::move(functions));
+
+        return result;
+    }
+
+    /* Evaluate with the caller's symbols, counting against its limits */
+    VALUE Compiled::eval(Evaluator* caller) {
+        string key;
+        vector<VALUE> functions;
+        bool cacheable = this->results && this->results->key(caller->getSymbols(), key, functions);
+        VALUE cached = cacheable ? this->results->find(key) : nullptr;
+
+        if(cached) return cached;
+
+        Evaluator evaluator(caller->getSymbols(), caller);
+
+        evaluator.source = this->source;
+        evaluator.reordering = this->reordering.get();
+
+        VALUE result = any_cast<VALUE>(evaluator.visit(this->parseTree));
+
+        if(cacheable) this->results->insert(key, result, std::move(functions));
+
+        return result;
+    }
+
+    /*
+    * Evaluate the operands of pure chains of && and || in the order that has
+    * been cheapest.  A program that reorders keeps statistics as it runs, so
+    * it must not be evaluated by more than one thread at a time.
+    */
+    void Compiled::setReordering(bool enabled) {
+        if(!enabled) this->reordering = nullptr;
+        else if(!this->reordering) this->reordering.reset(new Reordering(this->parseTree, this->source));
+    }
+
+    /* The chains of && and || being reordered, with their statistics */
+    vector<Chain> Compiled::getChains() const {
+        return this->reordering ? this->reordering->chains() : vector<Chain>();
+    }
+
+    /*
+    * Cache up to capacity results by the values the program reads, each for
+    * up to ttl if it isn't zero.  Only a program that writes no symbols and
+    * calls no built-ins but IF and the pure ones can be cached; for any
+    * other, this returns false.  Functions it calls are looked up on each
+    * evaluation, which is cached only if they are all pure, or built-ins the
+    * host hasn't replaced; results are kept apart by which ones were bound.
+    * A capacity of zero stops caching.  Like reordering, caching must not be
+    * used by more than one thread at a time.
+    */
+    bool Compiled::setCaching(size_t capacity, std::chrono::milliseconds ttl) {
+        Dependencies deps = this->dependencies();
+        bool pure = !deps.unknown && deps.writes.empty();
+        std::set<string> functions;
+
+        for(const string& name : deps.calls) {
+            if(builtins.count(name) && name != "IF" && !PURE_BUILTINS.count(name)) pure = false;
+            else functions.insert(name);
+        }
+
+        if(!pure || !capacity) {
+            this->results = nullptr;
+
+            return pure;
+        }
+
+        this->results.reset(new ResultCache(deps.reads, functions, capacity, ttl));
+
+        return true;
+    }
+
+    Caching Compiled::getCaching() const {
+        return this->results ? this->results->stats() : Caching();
+    }
+
+    string Compiled::getSource() const {
+        return *this->source;
+    }
+
+    /* Write the program to a compiled file for load_compiled() */
+    void Compiled::save(const string& path) const {
+        string image = TreeWriter().write(*this->source, this->parseTree);
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+
+        out.write(image.data(), image.size());
+
+        if(!out) throw BasicRuntimeError("Unable to write compiled file: " + path);
+    }
+
+    /* ***************************************************************************
+    * DEPENDENCIES
+    */
+
+    /*
+    * Walks a program in the order it runs.  A name assigned on every path
+    * before it is read is the program's own variable, not an input, so its
+    * reads are left out.  Branches are walked by a copy, whose assignments
+    * are forgotten when the branch ends.
+    */
+    /* The symbol a path starts with */
+    static string path_symbol(const string& path) {
+        return path.substr(0, path.find('.'));
+    }
+
+    class DependencyWalker {
+        Dependencies& deps;
+        std::set<string> assigned;
+
+        string path(LiteExprParser::VarnameContext* var, bool& computed);
+        void read(const string& path);
+        void call(LiteExprParser::CallContext* ctx);
+
+        public:
+            DependencyWalker(Dependencies& deps): deps(deps) {}
+            void walk(antlr4::tree::ParseTree* node);
+            void branch(antlr4::tree::ParseTree* node, const string& local="");
+    };
+
+    /* The path a variable names, up to its first computed key */
+    string DependencyWalker::path(LiteExprParser::VarnameContext* var, bool& computed) {
+        if(auto simple = dynamic_cast<LiteExprParser::SimpleVarContext*>(var)) {
+            string name = simple->ID()->getText();
+
+            if(name == "UPSCOPE" || name == "GLOBAL") this->deps.unknown = true;
+
+            return name;
+        }
+
+        if(auto member = dynamic_cast<LiteExprParser::MemberVarContext*>(var)) {
+            string base = this->path(member->varname(0), computed);
+
+            return computed ? base : base + "." + member->varname(1)->getText();
+        }
+
+        auto indexed = dynamic_cast<LiteExprParser::IndexedVarContext*>(var);
+        string base = this->path(indexed->varname(), computed);
+
+        this->walk(indexed->expr());
+        computed = true;
+
+        return base;
+    }
+
+    void DependencyWalker::read(const string& path) {
+        string name = path_symbol(path);
+
+        if(name == "UPSCOPE" || name == "GLOBAL" || this->assigned.count(name)) return;
+
+        this->deps.reads.insert(path);
+    }
+
+    void DependencyWalker::branch(antlr4::tree::ParseTree* node, const string& local) {
+        DependencyWalker inner(*this);
+
+        if(!local.empty()) inner.assigned.insert(local);
+
+        inner.walk(node);
+    }
+
+    /* Built-ins that take their arguments unevaluated run some of them only
+    * sometimes, or later */
+    void DependencyWalker::call(LiteExprParser::CallContext* ctx) {
+        bool computed = false;
+        string name = this->path(ctx->varname(), computed);
+        vector<LiteExprParser::ExprContext*> vexpr = ctx->list()->expr();
+        bool local = this->assigned.count(path_symbol(name));
+
+        if(!local) this->deps.calls.insert(name);
+        if(name == "EVAL") this->deps.unknown = true;
+
+        if(local || computed) {
+            /* an ordinary call */
+        }
+        else if(name == "IF" && vexpr.size() >= 2) {
+            this->walk(vexpr[0]);
+
+            for(size_t i = 1; i < vexpr.size(); i++) this->branch(vexpr[i]);
+
+            return;
+        }
+        else if(name == "WHILE" && vexpr.size() == 2) {
+            this->walk(vexpr[0]);
+            this->branch(vexpr[1]);
+
+            return;
+        }
+        else if(name == "FOR" && vexpr.size() == 4) {
+            DependencyWalker inner(*this);
+
+            this->walk(vexpr[0]);
+            this->walk(vexpr[1]);
+
+            inner.assigned = this->assigned;
+            inner.walk(vexpr[3]);
+            inner.walk(vexpr[2]);
+
+            return;
+        }
+        else if(name == "FOREACH" && vexpr.size() == 3) {
+            auto var = dynamic_cast<LiteExprParser::VariableContext*>(vexpr[0]);
+
+            if(var) {
+                auto simple = dynamic_cast<LiteExprParser::SimpleVarContext*>(var->varname());
+                bool indexed = false;
+
+                this->deps.writes.insert(this->path(var->varname(), indexed));
+                this->walk(vexpr[1]);
+                this->branch(vexpr[2], simple ? simple->ID()->getText() : "");
+
+                return;
+            }
+        }
+        else if(name == "FUNCTION" && vexpr.size() == 2) {
+            this->walk(vexpr[0]);
+            this->branch(vexpr[1], "ARG");
+
+            return;
+        }
+
+        for(auto expr : vexpr) this->walk(expr);
+    }
+
+    void DependencyWalker::walk(antlr4::tree::ParseTree* node) {
+        if(auto var = dynamic_cast<LiteExprParser::VariableContext*>(node)) {
+            bool computed = false;
+
+            this->read(this->path(var->varname(), computed));
+        }
+        else if(auto op = dynamic_cast<LiteExprParser::AssignOpContext*>(node)) {
+            string optext = op->op->getText();
+            bool computed = false;
+            string target = this->path(op->varname(), computed);
+
+            if(optext != "=") this->read(target);
+
+            if(optext == "||=" || optext == "&&=") this->branch(op->expr());
+            else this->walk(op->expr());
+
+            this->deps.writes.insert(target);
+
+            auto simple = dynamic_cast<LiteExprParser::SimpleVarContext*>(op->varname());
+            if(simple && optext == "=") this->assigned.insert(simple->ID()->getText());
+        }
+        else if(auto op = dynamic_cast<LiteExprParser::PrefixOpContext*>(node)) {
+            bool computed = false;
+            string target = this->path(op->varname(), computed);
+
+            this->read(target);
+            this->deps.writes.insert(target);
+        }
+        else if(auto op = dynamic_cast<LiteExprParser::PostfixOpContext*>(node)) {
+            bool computed = false;
+            string target = this->path(op->varname(), computed);
+
+            this->read(target);
+            this->deps.writes.insert(target);
+        }
+        else if(auto op = dynamic_cast<LiteExprParser::BinaryOpContext*>(node)) {
+            string optext = op->op->getText();
+
+            this->walk(op->expr(0));
+
+            if(optext == "&&" || optext == "||") this->branch(op->expr(1));
+            else this->walk(op->expr(1));
+        }
+        else if(auto op = dynamic_cast<LiteExprParser::TernaryOpContext*>(node)) {
+            this->walk(op->expr(0));
+            this->branch(op->expr(1));
+            this->branch(op->expr(2));
+        }
+        else if(auto call = dynamic_cast<LiteExprParser::CallContext*>(node)) {
+            this->call(call);
+        }
+        else {
+            for(auto child : node->children) this->walk(child);
+        }
+    }
+
+    /*
+    * The symbols the program may read and write, and the functions it may
+    * call, without running it.  Reads and calls in branches and function
+    * bodies are counted whether or not they would run.
+    */
+    Dependencies Compiled::dependencies() const {
+        Dependencies deps;
+
+        DependencyWalker(deps).walk(this->parseTree);
+
+        return deps;
+    }
+
+    /* ***************************************************************************
+    * SPECIALIZATION
+    */
+
+    /*
+    * Whether a name is one of the constants.  Only the table's own symbols
+    * count, and not the built-ins every table is made with, unless the host
+    * has replaced them.
+    */
+    static bool is_frozen(SYMBOLS constants, const string& name) {
+        const map<string,VALUE>& own = constants->native();
+        auto found = own.find(name);
+
+        return found != own.end() && !is_builtin(found->second, name);
+    }
+
+    /*
+    * Whether an expression reads nothing but constants.  The callee of a call
+    * and the member names of a path are not reads; a call is only folded if
+    * its callee is a pure built-in, or a pure host function among the
+    * constants.
+    */
+    static bool is_constant(antlr4::tree::ParseTree* node, SYMBOLS constants) {
+        if(auto var = dynamic_cast<LiteExprParser::SimpleVarContext*>(node)) {
+            string name = var->ID()->getText();
+
+            return name != "ARG" && name != "UPSCOPE" && name != "GLOBAL" && is_frozen(constants, name);
+        }
+
+        if(auto member = dynamic_cast<LiteExprParser::MemberVarContext*>(node)) {
+            return is_constant(member->varname(0), constants);
+        }
+
+        if(auto call = dynamic_cast<LiteExprParser::CallContext*>(node)) {
+            return is_constant(call->list(), constants);
+        }
+
+        for(auto child : node->children) {
+            if(!is_constant(child, constants)) return false;
+        }
+
+        return true;
+    }
+
+    /*
+    * The source of a number or string, if it can be written as one.  Other
+    * values are left where they are: arrays and objects would be rebuilt on
+    * every evaluation, and functions have no source.
+    */
+    static bool is_writable(VALUE value, string& text) {
+        if(!value) return false;
+
+        if(value->type() == typeid(Integer)) {
+            int64_t number = value->ivalue();
+
+            if(number == MININT) return false;
+
+            text = std::to_string(number);
+        }
+        else if(value->type() == typeid(Double)) {
+            double number = value->dvalue();
+            char buffer[DBL_MAX_10_EXP + 32];
+
+            if(!std::isfinite(number)) return false;
+
+            /* Fixed notation, since the grammar has no exponents */
+            text = string(buffer, std::to_chars(buffer, buffer + sizeof(buffer), number, std::chars_format::fixed).ptr);
+
+            if(text.find('.') == string::npos) text += ".0";
+        }
+        else if(value->type() == typeid(String)) {
+            text = String::encode(value->svalue());
+        }
+        else {
+            return false;
+        }
+
+        if(text[0] == '-') text = "(" + text + ")";
+
+        return true;
+    }
+
+    /*
+    * Rewrites a program with its constants in place.  Expressions that read
+    * only constants and call only pure built-ins are evaluated once, here;
+    * conditions that are decided drop the branches that cannot run.  Anything
+    * else is copied from the source as it was written.
+    */
+    class Specializer {
+        const string& source;
+        SYMBOLS constants;
+        Evaluator evaluator;
+        map<antlr4::tree::ParseTree*,VALUE> folded;
+        bool written;
+
+        bool fold(LiteExprParser::ExprContext* expr, VALUE& value);
+        string branch(LiteExprParser::ExprContext* expr);
+        string conditional(LiteExprParser::CallContext* ctx);
+        string splice(antlr4::ParserRuleContext* ctx);
+
+        public:
+            Specializer(const string& source, SYMBOLS constants): source(source), constants(constants), evaluator(constants), written(false) {}
+            string render(antlr4::tree::ParseTree* node);
+    };
+
+    /* The value of a constant expression.  One that fails is left to fail
+    * when the program runs, if it ever does. */
+    bool Specializer::fold(LiteExprParser::ExprContext* expr, VALUE& value) {
+        auto found = this->folded.find(expr);
+
+        if(found == this->folded.end()) {
+            VALUE result;
+
+            if(is_pure(expr, this->constants) && is_constant(expr, this->constants)) {
+                try {
+                    result = resolved(any_cast<VALUE>(this->evaluator.visit(expr)));
+                }
+                catch(const Error&) {
+                    result = nullptr;
+                }
+            }
+
+            found = this->folded.emplace(expr, result).first;
+        }
+
+        value = found->second;
+
+        return value != nullptr;
+    }
+
+    string Specializer::branch(LiteExprParser::ExprContext* expr) {
+        return "(" + this->render(expr) + ")";
+    }
+
+    /* IF without the conditions that are false, ending at the first that is
+    * true */
+    string Specializer::conditional(LiteExprParser::CallContext* ctx) {
+        vector<LiteExprParser::ExprContext*> vexpr = ctx->list()->expr();
+        vector<string> kept;
+        string otherwise;
+        size_t i;
+
+        for(i=0; i+1<vexpr.size(); i+=2) {
+            VALUE condition;
+
+            if(!this->fold(vexpr[i], condition)) {
+                kept.push_back(this->render(vexpr[i]));
+                kept.push_back(this->render(vexpr[i+1]));
+            }
+            else if(condition->istrue()) {
+                break;
+            }
+        }
+
+        if(i+1 < vexpr.size()) otherwise = this->render(vexpr[i+1]);
+        else if(i+1 == vexpr.size()) otherwise = this->render(vexpr[i]);
+
+        if(kept.empty() && otherwise.empty()) {
+            this->written = true;
+
+            return "0";
+        }
+
+        if(kept.empty()) return "(" + otherwise + ")";
+        if(!otherwise.empty()) kept.push_back(otherwise);
+
+        string text = "IF(" + kept[0];
+
+        for(size_t k=1; k<kept.size(); k++) text += ", " + kept[k];
+
+        this->written = false;
+
+        return text + ")";
+    }
+
+    /* The source of a node, with its children rendered */
+    string Specializer::splice(antlr4::ParserRuleContext* ctx) {
+        size_t at = ctx->start->getStartIndex();
+        string text;
+
+        for(auto child : ctx->children) {
+            auto inner = dynamic_cast<antlr4::ParserRuleContext*>(child);
+
+            /* Empty rules, such as an empty argument list, have no source */
+            if(!inner || !inner->stop || inner->stop->getTokenIndex() < inner->start->getTokenIndex()) continue;
+
+            text += this->source.substr(at, inner->start->getStartIndex() - at);
+            text += this->render(inner);
+            at = inner->stop->getStopIndex() + 1;
+        }
+
+        this->written = false;
+
+        return text + this->source.substr(at, ctx->stop->getStopIndex() + 1 - at);
+    }
+
+    /* The source of a node.  Afterwards, written says whether it became a
+    * literal */
+    string Specializer::render(antlr4::tree::ParseTree* node) {
+        VALUE value;
+        string text;
+
+        if(auto file = dynamic_cast<LiteExprParser::FileContext*>(node)) {
+            return file->expr() ? this->render(file->expr()) : "";
+        }
+
+        auto expr = dynamic_cast<LiteExprParser::ExprContext*>(node);
+
+        if(expr && this->fold(expr, value) && is_writable(value, text)) {
+            this->written = true;
+
+            return text;
+        }
+
+        if(auto op = dynamic_cast<LiteExprParser::BinaryOpContext*>(node)) {
+            string optext = op->op->getText();
+            bool logical = (optext == "&&" || optext == "||");
+
+            if(logical && this->fold(op->expr(0), value)) {
+                if(value->istrue() == (optext == "&&")) return this->branch(op->expr(1));
+
+                /* Otherwise the left operand is the result */
+                if(is_writable(value, text)) {
+                    this->written = true;
+
+                    return text;
+                }
+            }
+
+            /* A statement that came to nothing */
+            if(optext == ";") {
+                this->render(op->expr(0));
+
+                if(this->written) return this->branch(op->expr(1));
+            }
+        }
+        else if(auto op = dynamic_cast<LiteExprParser::TernaryOpContext*>(node)) {
+            if(this->fold(op->expr(0), value)) return this->branch(op->expr(value->istrue() ? 1 : 2));
+        }
+        else if(auto call = dynamic_cast<LiteExprParser::CallContext*>(node)) {
+            auto callee = dynamic_cast<LiteExprParser::SimpleVarContext*>(call->varname());
+
+            if(callee && callee->ID()->getText() == "IF" && call->list()->expr().size() >= 2) return this->conditional(call);
+        }
+
+        return this->splice(dynamic_cast<antlr4::ParserRuleContext*>(node));
+    }
+
+    /*
+    * The program with the symbols in constants frozen at their current
+    * values.  Numbers and strings they hold, or that can be worked out from
+    * them, are written into the program; arrays, objects and functions are
+    * still read from the symbols the program is evaluated with.
+    */
+    Compiled Compiled::specialize(SYMBOLS constants) const {
+        Dependencies deps = this->dependencies();
+
+        if(deps.unknown) throw BasicRuntimeError("Unable to specialize a program that uses EVAL, UPSCOPE, or GLOBAL");
+
+        for(const string& path : deps.writes) {
+            string name = path_symbol(path);
+
+            if(is_frozen(constants, name)) throw BasicRuntimeError("Assignment to constant symbol: " + name);
+        }
+
+        return Compiled(Specializer(*this->source, constants).render(this->parseTree));
+    }
+
+    /* ***************************************************************************
+    * PUBLIC FUNCTIONS
+    */
+
+    Compiled compile(const string& expr) {
+        return Compiled(expr);
+    }
+
+    Compiled compile(const string& expr, SYMBOLS constants) {
+        return Compiled(expr).specialize(constants);
+    }
+
+    /*
+    * Load a program saved by Compiled::save(), without lexing or parsing it.
+    */
+    Compiled load_compiled(const string& path) {
+        return Compiled(Compiled::Path{ path });
+    }
+
+    VALUE eval(const string& expr, SYMBOLS symbols, const Limits& limits) {
+        Compiled compiled = compile(expr);
+        VALUE result = compiled.eval(symbols, limits);
+
+        return result;
+    }
+}
+
+
+/* ***************************************************************************
+* LITERAL READER
+*/
+
+namespace liteexpr {
+    /*
+    * Reads the literal subset of the grammar -- numbers, strings, arrays and
+    * objects, optionally signed, with whitespace and comments -- straight
+    * into values, without a parse tree.  The result is what eval() would
+    * return for the same text.
+    */
+    class LiteralReader {
+        const char* begin;
+        const char* end;
+        const char* p;
+
+        void locate(const char* at, int& line, int& col) const;
+        std::string token(const char* at) const;
+        const char* closing(const char* quote) const;
+        [[noreturn]] void fail(const char* at) const;
+        void skip();
+        bool isIdStart(char c) const;
+        bool isDigit(char c) const;
+
+        VALUE value();
+        VALUE number();
+        VALUE string();
+        VALUE array();
+        VALUE object();
+
+        public:
+            LiteralReader(std::string_view text);
+            VALUE read();
+    };
+
+    LiteralReader::LiteralReader(std::string_view text) {
+        this->begin = text.data();
+        this->end = text.data() + text.size();
+        this->p = this->begin;
+    }
+
+    VALUE LiteralReader::read() {
+        VALUE result;
+
+        this->skip();
+        if(this->p == this->end) return make<Integer>(0);
+
+        result = this->value();
+
+        this->skip();
+        if(this->p != this->end) this->fail(this->p);
+
+        return result;
+    }
+
+    /* Lines and columns are only worked out for errors; columns count characters, not bytes */
+    void LiteralReader::locate(const char* at, int& line, int& col) const {
+        const char* bol = at;
+
+        while(bol > this->begin && bol[-1] != '\n') bol--;
+
+        line = 1 + std::count(this->begin, at, '\n');
+        col = std::count_if(bol, at, [](char c) { return (c & 0xC0) != 0x80; });
+    }
+
+    /* The text of the token the lexer would find at `at`, for errors */
+    std::string LiteralReader::token(const char* at) const {
+        static const char* const operators[] = {
+            ">>>=", "**=", "<<=", ">>=", ">>>", "&&=", "||=",
+            "++", "--", "**", "*=", "/=", "%=", "+=", "-=", "<<", ">>", "<=", ">=", "==", "!=", "&=", "^=", "|=", "&&", "||",
+        };
+        const char* q = at;
+
+        if(at == this->end) return "<EOF>";
+
+        if(*q == '"') {
+            const char* quote = this->closing(q);
+
+            q = quote ? quote + 1 : q + 1;
+        }
+        else if(this->isIdStart(*q)) {
+            while(q < this->end && (this->isIdStart(*q) || this->isDigit(*q))) q++;
+        }
+        else if(this->end - q > 2 && q[0] == '0' && q[1] == 'x' && std::isxdigit(static_cast<unsigned char>(q[2]))) {
+            q += 2;
+            while(q < this->end && std::isxdigit(static_cast<unsigned char>(*q))) q++;
+        }
+        else if(this->isDigit(*q) || (*q == '.' && q+1 < this->end && this->isDigit(q[1]))) {
+            if(*q == '0') q++;
+            else while(q < this->end && this->isDigit(*q)) q++;
+
+            if(q+1 < this->end && *q == '.' && this->isDigit(q[1])) {
+                q++;
+                while(q < this->end && this->isDigit(*q)) q++;
+            }
+        }
+        else {
+            for(const char* op : operators) {
+                size_t length = std::strlen(op);
+
+                if(this->end - q >= length && std::memcmp(q, op, length) == 0) return op;
+            }
+
+            q++;
+            while(q < this->end && (*q & 0xC0) == 0x80) q++;
+        }
+
+        return std::string(at, q);
+    }
+
+    /* A quote ends the string unless an odd number of backslashes precede it */
+    const char* LiteralReader::closing(const char* quote) const {
+        const char* body = quote + 1;
+        const char* q = body;
+
+        while(true) {
+            q = static_cast<const char*>(std::memchr(q, '"', this->end - q));
+
+            if(!q) return nullptr;
+
+            const char* b = q;
+            while(b > body && b[-1] == '\\') b--;
+
+            if((q - b) % 2 == 0) return q;
+
+            q++;
+        }
+    }
+
+    void LiteralReader::fail(const char* at) const {
+        int line, col;
+
+        this->locate(at, line, col);
+
+        throw SyntaxError("Unexpected token `" + this->token(at) + "`", line, col);
+    }
+
+    void LiteralReader::skip() {
+        while(this->p < this->end) {
+            char c = *this->p;
+
+            if(c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                this->p++;
+            }
+            else if(c == '#') {
+                const char* eol = static_cast<const char*>(std::memchr(this->p, '\n', this->end - this->p));
+
+                this->p = eol ? eol : this->end;
+            }
+            else if(c == '/' && this->p+1 < this->end && this->p[1] == '*') {
+                const char* q = this->p + 2;
+
+                while(true) {
+                    q = static_cast<const char*>(std::memchr(q, '*', this->end - q));
+
+                    /* Unterminated, so the lexer sees a `/` */
+                    if(!q || q+1 >= this->end) this->fail(this->p);
+                    if(q[1] == '/') break;
+
+                    q++;
+                }
+
+                this->p = q + 2;
+            }
+            else break;
+        }
+    }
+
+    bool LiteralReader::isIdStart(char c) const {
+        return c == '_' || ('a' <= c && c <= 'z') || ('A' <= c && c <= 'Z');
+    }
+
+    bool LiteralReader::isDigit(char c) const {
+        return '0' <= c && c <= '9';
+    }
+
+    VALUE LiteralReader::value() {
+        if(this->p == this->end) this->fail(this->p);
+
+        switch(*this->p) {
+            case '"': return this->string();
+            case '[': return this->array();
+            case '{': return this->object();
+
+            case '+':
+            case '-': {
+                const char* sign = this->p;
+                bool negative = (*sign == '-');
+
+                /* `++` and `--` are increments, which need a variable after them */
+                if(this->p+1 < this->end && this->p[1] == *sign) {
+                    this->p += 2;
+                    this->skip();
+                    this->fail(this->p);
+                }
+
+                this->p++;
+                this->skip();
+
+                VALUE v = this->value();
+
+                try {
+                    return negative ? v->op_neg() : v->op_pos();
+                }
+                catch(const BasicRuntimeError& e) {
+                    int line, col;
+
+                    this->locate(sign, line, col);
+
+                    throw RuntimeError(e, line, col);
+                }
+            }
+        }
+
+        return this->number();
+    }
+
+    VALUE LiteralReader::number() {
+        const char* start = this->p;
+
+        if(this->end - this->p > 2 && this->p[0] == '0' && this->p[1] == 'x' && std::isxdigit(static_cast<unsigned char>(this->p[2]))) {
+            this->p += 2;
+            while(this->p < this->end && std::isxdigit(static_cast<unsigned char>(*this->p))) this->p++;
+
+            return make<Integer>(Integer::decodeHex(std::string(start + 2, this->p)));
+        }
+
+        /* INT is 0 or has no leading zero; DOUBLE may start with its point */
+        if(this->p < this->end && *this->p == '0') this->p++;
+        else while(this->p < this->end && this->isDigit(*this->p)) this->p++;
+
+        if(this->p < this->end && *this->p == '.') {
+            const char* point = this->p++;
+
+            while(this->p < this->end && this->isDigit(*this->p)) this->p++;
+
+            if(this->p == point + 1) this->fail(point);
+
+            double decoded = 0;
+
+            std::from_chars(start, this->p, decoded);
+
+            return make<Double>(decoded);
+        }
+
+        if(this->p == start) this->fail(this->p);
+
+        uint64_t decoded = 0;
+
+        for(const char* q = start; q < this->p; q++) decoded = decoded * 10 + (*q - '0');
+
+        return make<Integer>(static_cast<int64_t>(decoded));
+    }
+
+    VALUE LiteralReader::string() {
+        const char* body = this->p + 1;
+        const char* q = this->closing(this->p);
+
+        if(!q) this->fail(this->end);
+
+        this->p = q + 1;
+
+        if(!std::memchr(body, '\\', q - body)) {
+            return make<String>(std::string(body, q));
+        }
+
+        try {
+            return make<String>(String::decode(std::string(body - 1, q + 1)));
+        }
+        catch(const BasicSyntaxError& e) {
+            int line, col;
+
+            this->locate(body - 1, line, col);
+
+            throw SyntaxError(e, line, col);
+        }
+    }
+
+    VALUE LiteralReader::array() {
+        vector<VALUE> elements;
+
+        this->p++;
+        this->skip();
+
+        while(this->p < this->end && *this->p != ']') {
+            elements.push_back(this->value());
+            this->skip();
+
+            if(this->p < this->end && *this->p == ',') {
+                this->p++;
+                this->skip();
+            }
+            else break;
+        }
+
+        if(this->p == this->end || *this->p != ']') this->fail(this->p);
+        this->p++;
+
+        return make<Array>(std::move(elements));
+    }
+
+    VALUE LiteralReader::object() {
+        map<std::string,VALUE> members;
+
+        this->p++;
+        this->skip();
+
+        while(this->p < this->end && this->isIdStart(*this->p)) {
+            const char* key = this->p;
+
+            while(this->p < this->end && (this->isIdStart(*this->p) || this->isDigit(*this->p))) this->p++;
+
+            std::string k(key, this->p);
+
+            this->skip();
+            if(this->p == this->end || *this->p != ':') this->fail(this->p);
+            this->p++;
+            this->skip();
+
+            members.insert_or_assign(std::move(k), this->value());
+            this->skip();
+
+            if(this->p < this->end && *this->p == ',') {
+                this->p++;
+                this->skip();
+            }
+            else break;
+        }
+
+        if(this->p == this->end || *this->p != '}') this->fail(this->p);
+        this->p++;
+
+        return make<Object>(std::move(members));
     }
 
-    Function::Function(VALUE (*dfunc)(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor), int64_t minargs, int64_t maxargs) {
-        this->func = nullptr;
-        this->dfunc = dfunc;
-        this->xfunc = nullptr;
-        this->staticExpr = nullptr;
-        this->minargs = minargs;
-        this->maxargs = maxargs;
-        this->scope = nullptr;
+    /*
+    * Read a value written as a literal, such as reference data, without
+    * compiling it.
+    */
+    VALUE parse_value(std::string_view text) {
+        return LiteralReader(text).read();
     }
+}
 
-    Function::Function(VALUE (*xfunc)(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor, SYMBOLS scope), SYMBOLS scope, int64_t minargs, int64_t maxargs) {
-        this->func = nullptr;
-        this->dfunc = nullptr;
-        this->xfunc = xfunc;
-        this->staticExpr = nullptr;
-        this->minargs = minargs;
-        this->maxargs = maxargs;
-        this->scope = scope;
+
+/* ***************************************************************************
+* SNAPSHOT
+*/
+
+namespace liteexpr {
+    /*
+    * A snapshot is a header, the values, the offset of each value, and the
+    * offset of that table.  Every field is a 64-bit word in the byte order of
+    * the machine that wrote it, and every value starts on a word boundary,
+    * so a snapshot can be mapped and read in place.  Each value starts with
+    * its tag:
+    *
+    *   INTEGER  value
+    *   DOUBLE   value
+    *   STRING   length, bytes
+    *   ARRAY    count, element...
+    *   OBJECT   count, (member, key offset, key length)..., keys
+    *   SYMBOLS  parent, then as OBJECT
+    *
+    * Elements, members and parents are value numbers; the root is value 0.
+    * Keys are sorted, so one member can be found without reading the rest.
+    * Values referred to more than once are tagged SHARED.
+    */
+    static const char SNAPSHOT_MAGIC[8] = { 'L', 'E', 'S', 'N', 'A', 'P', '0', '1' };
+    static const uint64_t SNAPSHOT_VERSION = 1;
+    static const uint64_t SNAPSHOT_ORDER = 0x0102030405060708;
+    static const uint64_t SNAPSHOT_HEADER = 4 * 8;
+    static const uint64_t SNAPSHOT_NONE = ~uint64_t(0);
+
+    enum SnapshotTag: uint64_t {
+        SNAPSHOT_INTEGER = 1,
+        SNAPSHOT_DOUBLE = 2,
+        SNAPSHOT_STRING = 3,
+        SNAPSHOT_ARRAY = 4,
+        SNAPSHOT_OBJECT = 5,
+        SNAPSHOT_SYMBOLS = 6,
+        SNAPSHOT_SHARED = 0x100,
+    };
+
+    /* The members of an object or symbol table that are saved: functions,
+    * UPSCOPE and GLOBAL are left out */
+    static vector<pair<const string*,VALUE> > saved_members(const VALUE& object) {
+        vector<pair<const string*,VALUE> > members;
+
+        for(const auto& kv : object->ovalue()) {
+            if(kv.first == "UPSCOPE" || kv.first == "GLOBAL") continue;
+
+            VALUE value = resolved(kv.second);
+
+            if(value->type() == typeid(Function)) continue;
+
+            members.push_back({ &kv.first, value });
+        }
+
+        return members;
+    }
+
+    static SYMBOLS saved_parent(const VALUE& table) {
+        return dynamic_pointer_cast<SymbolTable>(static_cast<SymbolTable*>(table.get())->find("UPSCOPE"));
+    }
+
+    class SnapshotWriter {
+        std::ostream& out;
+        std::unordered_map<const Value*,uint64_t> numbers;
+        vector<VALUE> values;
+        vector<uint64_t> references;
+        uint64_t offset;
+
+        uint64_t number(const VALUE& value);
+        void put(uint64_t word);
+        void put(const char* bytes, size_t size);
+
+        public:
+            SnapshotWriter(std::ostream& out);
+            void write(VALUE root);
+    };
+
+    SnapshotWriter::SnapshotWriter(std::ostream& out): out(out) {
+        this->offset = 0;
+    }
+
+    /* Number each value the first time it is reached, counting references */
+    uint64_t SnapshotWriter::number(const VALUE& value) {
+        auto found = this->numbers.find(value.get());
+
+        if(found != this->numbers.end()) {
+            this->references[found->second]++;
+
+            return found->second;
+        }
+
+        const type_info& type = value->type();
+        uint64_t n = this->values.size();
+
+        if(type != typeid(Integer) && type != typeid(Double) && type != typeid(String)
+        && type != typeid(Array) && type != typeid(Object) && type != typeid(SymbolTable)) {
+            throw BasicRuntimeError(ErrorCode::UNSUPPORTED_OPERAND, "save_snapshot()", value->name());
+        }
+
+        this->numbers[value.get()] = n;
+        this->values.push_back(value);
+        this->references.push_back(1);
+
+        if(type == typeid(Array)) {
+            for(const VALUE& element : value->avalue()) this->number(resolved(element));
+        }
+        else if(type == typeid(SymbolTable)) {
+            SYMBOLS parent = saved_parent(value);
+
+            if(parent) this->number(parent);
+            for(const auto& member : saved_members(value)) this->number(member.second);
+        }
+        else if(type == typeid(Object)) {
+            for(const auto& member : saved_members(value)) this->number(member.second);
+        }
+
+        return n;
+    }
+
+    void SnapshotWriter::put(uint64_t word) {
+        this->put(reinterpret_cast<const char*>(&word), sizeof(word));
+    }
+
+    /* Bytes, padded to a word */
+    void SnapshotWriter::put(const char* bytes, size_t size) {
+        static const char padding[8] = {};
+        size_t padded = (size + 7) & ~size_t(7);
+
+        this->out.write(bytes, size);
+        this->out.write(padding, padded - size);
+        this->offset += padded;
+    }
+
+    void SnapshotWriter::write(VALUE root) {
+        vector<uint64_t> offsets;
+
+        this->number(resolved(root));
+
+        this->put(SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+        this->put(SNAPSHOT_VERSION);
+        this->put(SNAPSHOT_ORDER);
+        this->put(this->values.size());
+
+        for(uint64_t n = 0; n < this->values.size(); n++) {
+            const VALUE& value = this->values[n];
+            const type_info& type = value->type();
+            uint64_t shared = (this->references[n] > 1) ? SNAPSHOT_SHARED : 0;
+
+            offsets.push_back(this->offset);
+
+            if(type == typeid(Integer)) {
+                int64_t v = value->ivalue();
+
+                this->put(SNAPSHOT_INTEGER | shared);
+                this->put(reinterpret_cast<const char*>(&v), sizeof(v));
+            }
+            else if(type == typeid(Double)) {
+                double v = value->dvalue();
+
+                this->put(SNAPSHOT_DOUBLE | shared);
+                this->put(reinterpret_cast<const char*>(&v), sizeof(v));
+            }
+            else if(type == typeid(String)) {
+                const string& v = static_cast<String*>(value.get())->native();
+
+                this->put(SNAPSHOT_STRING | shared);
+                this->put(v.size());
+                this->put(v.data(), v.size());
+            }
+            else if(type == typeid(Array)) {
+                const vector<VALUE>& elements = value->avalue();
+
+                this->put(SNAPSHOT_ARRAY | shared);
+                this->put(elements.size());
+
+                for(const VALUE& element : elements) this->put(this->numbers[resolved(element).get()]);
+            }
+            else {
+                vector<pair<const string*,VALUE> > members = saved_members(value);
+                uint64_t key = members.size() * 3 * 8;
+
+                if(type == typeid(SymbolTable)) {
+                    SYMBOLS parent = saved_parent(value);
+
+                    this->put(SNAPSHOT_SYMBOLS | shared);
+                    this->put(parent ? this->numbers[parent.get()] : SNAPSHOT_NONE);
+                }
+                else {
+                    this->put(SNAPSHOT_OBJECT | shared);
+                }
+
+                this->put(members.size());
+
+                /* Key offsets are from the first member */
+                for(const auto& member : members) {
+                    this->put(this->numbers[member.second.get()]);
+                    this->put(key);
+                    this->put(member.first->size());
+
+                    key += (member.first->size() + 7) & ~uint64_t(7);
+                }
+
+                for(const auto& member : members) this->put(member.first->data(), member.first->size());
+            }
+        }
+
+        uint64_t table = this->offset;
+
+        for(uint64_t offset : offsets) this->put(offset);
+        this->put(table);
+    }
+
+    /*
+    * A mapped snapshot, from which values are loaded as they are reached.
+    * Shared values are loaded once for as long as they are in use.
+    */
+    class SnapshotFile: public std::enable_shared_from_this<SnapshotFile> {
+        string path;
+        MappedFile file;
+        uint64_t count;
+        uint64_t table;
+        std::unordered_map<uint64_t,std::weak_ptr<Value> > shared;
+        std::set<uint64_t> ancestors;
+
+        [[noreturn]] void invalid() const;
+
+        public:
+            SnapshotFile(const string& path);
+
+            uint64_t word(uint64_t offset) const;
+            std::string_view bytes(uint64_t offset, uint64_t size) const;
+            VALUE load(uint64_t n);
+    };
+
+    /*
+    * An object or symbol table whose members are loaded from the snapshot
+    * when first looked up.  Anything that needs every member loads the rest
+    * and lets go of the snapshot.
+    */
+    template<typename Base> class Snapshotted: public Base {
+        mutable shared_ptr<SnapshotFile> file;
+        mutable vector<bool> loaded;
+        uint64_t members;
+
+        void fetch(const string& k);
+        void fetchAll() const;
+
+        public:
+            template<typename... Args> Snapshotted(shared_ptr<SnapshotFile> file, uint64_t members, Args&&... args);
+
+            VALUE find(const string& k) override { this->fetch(k); return Base::find(k); }
+            void set(const string& k, VALUE v) override { this->fetch(k); Base::set(k, v); }
+            bool has(const string& k) override { this->fetch(k); return Base::has(k); }
+
+            string encoded() const override { this->fetchAll(); return Base::encoded(); }
+            void write(Writer& out) const override { this->fetchAll(); Base::write(out); }
+            const type_info& type() const override { return typeid(Base); }
+            bool istrue() const override { this->fetchAll(); return Base::istrue(); }
+            int64_t length() const override { this->fetchAll(); return Base::length(); }
+            const map<string,VALUE>& ovalue() const override { this->fetchAll(); return Base::ovalue(); }
+            string svalue() const override { this->fetchAll(); return Base::svalue(); }
+            VALUE op_eq(const VALUE other) const override { this->fetchAll(); return Base::op_eq(other); }
+            VALUE op_ne(const VALUE other) const override { this->fetchAll(); return Base::op_ne(other); }
+            void clear() override { this->file = nullptr; Base::clear(); }
+    };
+
+    template<typename Base> template<typename... Args> Snapshotted<Base>::Snapshotted(shared_ptr<SnapshotFile> file, uint64_t members, Args&&... args): Base(std::forward<Args>(args)...) {
+        this->file = file;
+        this->members = members;
+        this->loaded.resize(file->word(members - 8));
+    }
+
+    /* Load member k if the snapshot has it and it is not loaded yet */
+    template<typename Base> void Snapshotted<Base>::fetch(const string& k) {
+        if(!this->file) return;
+
+        size_t lo = 0;
+        size_t hi = this->loaded.size();
+
+        while(lo < hi) {
+            size_t mid = lo + (hi - lo) / 2;
+            uint64_t member = this->members + mid * 3 * 8;
+            int order = this->file->bytes(this->members + this->file->word(member + 8), this->file->word(member + 16)).compare(k);
+
+            if(order < 0) lo = mid + 1;
+            else if(order > 0) hi = mid;
+            else {
+                if(!this->loaded[mid]) {
+                    this->loaded[mid] = true;
+                    this->Object::set(k, this->file->load(this->file->word(member)));
+                }
+
+                return;
+            }
+        }
+    }
+
+    template<typename Base> void Snapshotted<Base>::fetchAll() const {
+        if(!this->file) return;
+
+        Snapshotted* self = const_cast<Snapshotted*>(this);
+        shared_ptr<SnapshotFile> file = this->file;
+
+        for(size_t i = 0; i < this->loaded.size(); i++) {
+            uint64_t member = this->members + i * 3 * 8;
+
+            if(this->loaded[i]) continue;
+
+            this->loaded[i] = true;
+            self->Object::set(string(file->bytes(this->members + file->word(member + 8), file->word(member + 16))), file->load(file->word(member)));
+        }
+
+        this->file = nullptr;
+        this->loaded.clear();
+    }
+
+    SnapshotFile::SnapshotFile(const string& path): path(path), file(path, "snapshot") {
+        if(this->file.size < SNAPSHOT_HEADER + 8) this->invalid();
+
+        this->count = this->word(24);
+        this->table = this->word(this->file.size - 8);
+
+        if(memcmp(this->file.data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0
+        || this->word(8) != SNAPSHOT_VERSION || this->word(16) != SNAPSHOT_ORDER
+        || this->count == 0 || this->table < SNAPSHOT_HEADER || this->table > this->file.size - 8
+        || (this->file.size - 8 - this->table) / 8 != this->count) {
+            this->invalid();
+        }
+    }
+
+    void SnapshotFile::invalid() const {
+        throw BasicRuntimeError("Invalid snapshot: " + this->path);
+    }
+
+    uint64_t SnapshotFile::word(uint64_t offset) const {
+        uint64_t w;
+
+        if(offset % 8 || offset > this->file.size - 8) this->invalid();
+
+        memcpy(&w, this->file.data + offset, sizeof(w));
+
+        return w;
+    }
+
+    std::string_view SnapshotFile::bytes(uint64_t offset, uint64_t size) const {
+        if(offset > this->file.size || size > this->file.size - offset) this->invalid();
+
+        return std::string_view(this->file.data + offset, size);
+    }
+
+    /* Value n, loaded now except for the members of objects and tables */
+    VALUE SnapshotFile::load(uint64_t n) {
+        if(n >= this->count) this->invalid();
+
+        uint64_t offset = this->word(this->table + n * 8);
+        uint64_t tag = this->word(offset);
+        VALUE value;
+
+        if(tag & SNAPSHOT_SHARED) {
+            VALUE found = this->shared[n].lock();
+
+            if(found) return found;
+        }
+
+        switch(tag & ~uint64_t(SNAPSHOT_SHARED)) {
+            case SNAPSHOT_INTEGER:
+                value = make<Integer>(int64_t(this->word(offset + 8)));
+                break;
+
+            case SNAPSHOT_DOUBLE: {
+                uint64_t w = this->word(offset + 8);
+                double d;
+
+                memcpy(&d, &w, sizeof(d));
+                value = make<Double>(d);
+                break;
+            }
+
+            case SNAPSHOT_STRING:
+                value = make<String>(string(this->bytes(offset + 16, this->word(offset + 8))));
+                break;
+
+            /* Elements are loaded after the array is registered, so an
+            * array may contain itself */
+            case SNAPSHOT_ARRAY: {
+                uint64_t size = this->word(offset + 8);
+                shared_ptr<Array> array = std::static_pointer_cast<Array>(make<Array>());
+
+                if(tag & SNAPSHOT_SHARED) this->shared[n] = array;
+
+                for(uint64_t i = 0; i < size; i++) array->push(this->load(this->word(offset + 16 + i * 8)));
+
+                return array;
+            }
+
+            case SNAPSHOT_OBJECT:
+                value = make<Snapshotted<Object> >(this->shared_from_this(), offset + 16);
+                break;
+
+            case SNAPSHOT_SYMBOLS: {
+                uint64_t parent = this->word(offset + 8);
+                SYMBOLS scope;
+
+                /* A parent may be numbered before or after its children, but
+                * a table can't be its own ancestor */
+                if(parent != SNAPSHOT_NONE) {
+                    if(!this->ancestors.insert(n).second) this->invalid();
+
+                    try {
+                        scope = dynamic_pointer_cast<SymbolTable>(this->load(parent));
+                    }
+                    catch(...) {
+                        this->ancestors.erase(n);
+                        throw;
+                    }
+
+                    this->ancestors.erase(n);
+                }
+
+                if(parent != SNAPSHOT_NONE && !scope) this->invalid();
+
+                value = make<Snapshotted<SymbolTable> >(this->shared_from_this(), offset + 24, scope);
+                break;
+            }
+
+            default:
+                this->invalid();
+        }
+
+        if(tag & SNAPSHOT_SHARED) this->shared[n] = value;
+
+        return value;
+    }
+
+    /*
+    * Save a value, such as a symbol table of reference data, so it can be
+    * loaded later without parsing.  Functions are not saved.
+    */
+    void save_snapshot(std::ostream& out, VALUE value) {
+        SnapshotWriter(out).write(value);
+
+        if(!out) throw BasicRuntimeError("Unable to write snapshot");
+    }
+
+    void save_snapshot(const string& path, VALUE value) {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+
+        if(!out) throw BasicRuntimeError("Unable to write snapshot: " + path);
+
+        save_snapshot(out, value);
+    }
+
+    /*
+    * Load a saved value.  The file is mapped rather than read, and members
+    * of objects and symbol tables are loaded when they are first looked up.
+    */
+    VALUE load_snapshot(const string& path) {
+        return std::make_shared<SnapshotFile>(path)->load(0);
+    }
+}
+
+
+/* ***************************************************************************
+* DEPENDENCY GRAPH
+*/
+
+namespace liteexpr {
+    DependencyGraph::DependencyGraph(SYMBOLS symbols) {
+        this->symbols = symbols;
+        this->updating = false;
+
+        this->symbols->setObserver([this](const string& k) {
+            if(!this->updating) this->invalidate(k, 0);
+        });
+    }
+
+    DependencyGraph::~DependencyGraph() {
+        this->symbols->setObserver(nullptr);
+    }
+
+    /*
+    * Add a program, stored under name when it is evaluated.  Throws if it
+    * would make programs depend on each other in a circle.
+    */
+    void DependencyGraph::define(const string& name, const string& expr) {
+        shared_ptr<Compiled> program(new Compiled(expr));
+        Dependencies deps = program->dependencies();
+
+        auto found = this->nodes.find(name);
+        std::unique_ptr<Node> before(found != this->nodes.end() ? new Node(found->second) : nullptr);
+
+        this->nodes[name] = Node{ program, deps, nullptr, true, nullptr };
+
+        try {
+            this->sort();
+        }
+        catch(const Error&) {
+            if(before) this->nodes[name] = *before;
+            else this->nodes.erase(name);
+
+            this->sort();
+
+            throw;
+        }
+    }
+
+    /* Whether a program reads a symbol, or may */
+    static bool reads_symbol(const Dependencies& deps, const string& k) {
+        if(deps.unknown) return true;
+
+        for(const string& path : deps.reads) if(path_symbol(path) == k) return true;
+        for(const string& path : deps.calls) if(path_symbol(path) == k) return true;
+
+        return false;
+    }
+
+    /* Place a program after the programs that write what it reads */
+    void DependencyGraph::visit(const string& name, const map<string,std::set<string> >& writers, map<string,int>& marks) {
+        int& mark = marks[name];
+
+        if(mark == 2) return;
+        if(mark == 1) throw BasicRuntimeError("Circular dependency: " + name);
+
+        mark = 1;
+
+        for(const auto& writer : writers) {
+            if(!reads_symbol(this->nodes[name].deps, writer.first)) continue;
+
+            for(const string& other : writer.second) {
+                if(other != name) this->visit(other, writers, marks);
+            }
+        }
+
+        mark = 2;
+        this->order.push_back(name);
+    }
+
+    /*
+    * Order the programs so each comes after those whose results or writes it
+    * reads.  Programs that may read anything come last, in name order.
+    */
+    void DependencyGraph::sort() {
+        map<string,std::set<string> > writers;
+        map<string,int> marks;
+
+        for(const auto& node : this->nodes) {
+            if(node.second.deps.unknown) continue;
+
+            writers[node.first].insert(node.first);
+
+            for(const string& path : node.second.deps.writes) {
+                writers[path_symbol(path)].insert(node.first);
+            }
+        }
+
+        this->order.clear();
+
+        for(const auto& node : this->nodes) {
+            if(!node.second.deps.unknown) this->visit(node.first, writers, marks);
+        }
+
+        for(const auto& node : this->nodes) {
+            if(node.second.deps.unknown) this->order.push_back(node.first);
+        }
+    }
+
+    /* Mark the programs that read a symbol stale, from a position in the order on */
+    void DependencyGraph::invalidate(const string& k, size_t after) {
+        for(size_t i = after; i < this->order.size(); i++) {
+            Node& node = this->nodes[this->order[i]];
+
+            if(this->order[i] != k && reads_symbol(node.deps, k)) node.stale = true;
+        }
+    }
+
+    /* Whether a result is the same as the one before it */
+    static bool same_result(VALUE before, VALUE after) {
+        if(before == after) return true;
+        if(!before || before->type() != after->type() || after->type() == typeid(Function)) return false;
+
+        return before->encoded() == after->encoded();
+    }
+
+    /*
+    * Evaluate a program if it is stale, and mark the programs that read what
+    * it changed stale.  A program that fails keeps its error, which is thrown
+    * again whenever it is needed, until it is stale again.  Returns whether
+    * it was evaluated.
+    */
+    bool DependencyGraph::evaluate(size_t i) {
+        const string& name = this->order[i];
+        Node& node = this->nodes[name];
+        VALUE result;
+
+        if(!node.stale) {
+            if(node.error) std::rethrow_exception(node.error);
+
+            return false;
+        }
+
+        this->updating = true;
+
+        try {
+            result = node.program->eval(this->symbols);
+            this->symbols->define(name, result);
+        }
+        catch(...) {
+            this->updating = false;
+            node.error = std::current_exception();
+            node.stale = false;
+            throw;
+        }
+
+        this->updating = false;
+
+        if(!same_result(node.result, result)) this->invalidate(name, i+1);
+        for(const string& path : node.deps.writes) this->invalidate(path_symbol(path), i+1);
+
+        node.result = result;
+        node.error = nullptr;
+        node.stale = false;
+
+        return true;
     }
 
-    VALUE Function::call(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor) const {
-        if(vexpr.size() < this->minargs || this->maxargs < vexpr.size()) {
-            throw BasicSyntaxError(string("Invalid argument count. min=")
-                + std::to_string(this->minargs) + ", max="
-                + std::to_string(this->maxargs) + ", got="
-                + std::to_string(vexpr.size())
-            );
+    /*
+    * Evaluate the stale programs in dependency order and return their names.
+    * A program whose result is unchanged leaves the programs reading it as
+    * they were.
+    */
+    vector<string> DependencyGraph::update() {
+        vector<string> evaluated;
+
+        for(size_t i = 0; i < this->order.size(); i++) {
+            if(this->evaluate(i)) evaluated.push_back(this->order[i]);
         }
 
-        if(this->func) {
-            vector<VALUE> args;
+        return evaluated;
+    }
 
-            for(LiteExprParser::ExprContext* expr : vexpr) {
-                args.push_back(any_cast<VALUE>(visitor->visit(expr)));
+    /* A program's result, brought up to date with the programs it depends on */
+    VALUE DependencyGraph::get(const string& name) {
+        if(!this->nodes.count(name)) throw BasicRuntimeError(ErrorCode::UNKNOWN_SYMBOL, nullptr, name);
+
+        size_t at = std::find(this->order.begin(), this->order.end(), name) - this->order.begin();
+        vector<bool> needed(at + 1, false);
+
+        /* The order puts every program after those it depends on */
+        needed[at] = true;
+
+        for(size_t i = at; i-- > 0; ) {
+            const Node& node = this->nodes[this->order[i]];
+
+            for(size_t j = i + 1; j <= at && !needed[i]; j++) {
+                const Dependencies& deps = this->nodes[this->order[j]].deps;
+
+                if(!needed[j]) continue;
+                if(reads_symbol(deps, this->order[i])) needed[i] = true;
+
+                for(const string& path : node.deps.writes) {
+                    if(reads_symbol(deps, path_symbol(path))) needed[i] = true;
+                }
             }
+        }
 
-            return this->func(args);
+        for(size_t i = 0; i <= at; i++) {
+            if(needed[i]) this->evaluate(i);
         }
-        else if(this->xfunc) {
-           vector<LiteExprParser::ExprContext*> sexpr;
 
-           sexpr.push_back(this->staticExpr);
-           sexpr.insert(sexpr.end(), vexpr.begin(), vexpr.end());
+        return this->nodes[name].result;
+    }
+}
 
-           return this->xfunc(sexpr, visitor, this->scope);
+
+/* ***************************************************************************
+* RULE SET
+*/
+
+namespace liteexpr {
+    /*
+    * Numbers the subtrees of programs so identical subtrees get the same
+    * number, and collects the pure ones worth sharing.  A subtree is pure if
+    * it has no assignments, array or object literals, or calls to anything
+    * but pure built-ins, and reads no symbol that a program writes.
+    */
+    class SubtreeNumbering {
+        const std::set<string>& written;
+        map<string,size_t> numbers;
+
+        bool allowed(antlr4::tree::ParseTree* node) const;
+
+        public:
+            map<size_t,vector<antlr4::tree::ParseTree*> > candidates;
+
+            SubtreeNumbering(const std::set<string>& written): written(written) {}
+            size_t number(antlr4::tree::ParseTree* node, bool& pure);
+    };
+
+    bool SubtreeNumbering::allowed(antlr4::tree::ParseTree* node) const {
+        if(dynamic_cast<LiteExprParser::AssignOpContext*>(node))  return false;
+        if(dynamic_cast<LiteExprParser::PrefixOpContext*>(node))  return false;
+        if(dynamic_cast<LiteExprParser::PostfixOpContext*>(node)) return false;
+        if(dynamic_cast<LiteExprParser::ObjectContext*>(node))    return false;
+        if(dynamic_cast<LiteExprParser::ArrayContext*>(node))     return false;
+
+        if(auto var = dynamic_cast<LiteExprParser::SimpleVarContext*>(node)) {
+            string name = var->ID()->getText();
+
+            return name != "ARG" && name != "UPSCOPE" && name != "GLOBAL" && !this->written.count(name);
         }
-        else if(this->staticExpr) {
-           vector<LiteExprParser::ExprContext*> sexpr;
 
-           sexpr.push_back(this->staticExpr);
-           sexpr.insert(sexpr.end(), vexpr.begin(), vexpr.end());
+        if(auto call = dynamic_cast<LiteExprParser::CallContext*>(node)) {
+            auto callee = dynamic_cast<LiteExprParser::SimpleVarContext*>(call->varname());
 
-           return this->dfunc(sexpr, visitor);
+            return callee && PURE_BUILTINS.count(callee->ID()->getText());
+        }
+
+        return true;
+    }
+
+    size_t SubtreeNumbering::number(antlr4::tree::ParseTree* node, bool& pure) {
+        string key;
+
+        if(auto terminal = dynamic_cast<antlr4::tree::TerminalNode*>(node)) {
+            string text = terminal->getText();
+
+            key = "'" + std::to_string(text.size()) + ":" + text;
+            pure = true;
         }
         else {
-            return this->dfunc(vexpr, visitor);
+            key = string(typeid(*node).name()) + "(";
+            pure = this->allowed(node);
+
+            for(auto child : node->children) {
+                bool childPure;
+
+                key += std::to_string(this->number(child, childPure)) + ",";
+                pure = pure && childPure;
+            }
+
+            key += ")";
+        }
+
+        size_t number = this->numbers.emplace(key, this->numbers.size()).first->second;
+        auto op = dynamic_cast<LiteExprParser::BinaryOpContext*>(node);
+
+        /* Only operations are worth sharing */
+        if(pure && ((op && op->op->getText() != ";")
+            || dynamic_cast<LiteExprParser::UnaryOpContext*>(node)
+            || dynamic_cast<LiteExprParser::CallContext*>(node))) {
+            this->candidates[number].push_back(node);
         }
+
+        return number;
     }
 
-    SYMBOLS Function::getScope() const {
-        return this->scope;
+    /*
+    * Guards are comparisons of a symbol or member path with a constant at the
+    * start of a rule's top-level chain of &&.  When a guard is false and the
+    * guards before it are true, the rule is 0 and needn't be evaluated.  The
+    * guards on each path are indexed by their constants, equalities in hash
+    * tables and ranges in sorted lists, so a record only visits the guards
+    * that may hold.  Guards that can't be decided, because the path is
+    * missing or not a number or string, leave their rules to be evaluated.
+    */
+    class PredicateIndex {
+        struct Guard {
+            size_t rule;
+            string op;
+            VALUE constant;
+        };
+
+        struct Path {
+            LiteExprParser::VariableContext* var = nullptr;
+            vector<size_t> rules;
+            std::unordered_map<double,vector<Guard> > numbers;
+            std::unordered_map<string,vector<Guard> > strings;
+            vector<Guard> unequal;
+            vector<pair<double,Guard> > lower;
+            vector<pair<double,Guard> > upper;
+            bool sorted = false;
+        };
+
+        map<string,Path> paths;
+        vector<size_t> counts;
+        Evaluator constants;
+
+        bool guard(size_t rule, LiteExprParser::ExprContext* expr, const std::set<string>& written);
+        static bool holds(VALUE value, const Guard& guard);
+
+        public:
+            PredicateIndex(): constants(SYMBOLS(new SymbolTable())) {}
+            size_t add(antlr4::ParserRuleContext* tree, const std::set<string>& written);
+            vector<bool> match(SYMBOLS symbols);
+    };
+
+    /* A symbol, or members of one, that no rule writes */
+    static bool is_path(LiteExprParser::VarnameContext* var, const std::set<string>& written) {
+        if(auto member = dynamic_cast<LiteExprParser::MemberVarContext*>(var)) {
+            return is_path(member->varname(0), written);
+        }
+
+        auto simple = dynamic_cast<LiteExprParser::SimpleVarContext*>(var);
+        string name = simple ? simple->ID()->getText() : "";
+
+        return simple && name != "ARG" && name != "UPSCOPE" && name != "GLOBAL" && !written.count(name);
     }
 
-    string Function::name() const {
-        return "Function";
+    static bool is_literal(LiteExprParser::ExprContext* expr) {
+        auto unary = dynamic_cast<LiteExprParser::UnaryOpContext*>(expr);
+
+        if(unary && (unary->op->getText() == "-" || unary->op->getText() == "+")) {
+            return dynamic_cast<LiteExprParser::IntContext*>(unary->expr())
+                || dynamic_cast<LiteExprParser::HexContext*>(unary->expr())
+                || dynamic_cast<LiteExprParser::DoubleContext*>(unary->expr());
+        }
+
+        return dynamic_cast<LiteExprParser::IntContext*>(expr)
+            || dynamic_cast<LiteExprParser::HexContext*>(expr)
+            || dynamic_cast<LiteExprParser::DoubleContext*>(expr)
+            || dynamic_cast<LiteExprParser::StringContext*>(expr);
     }
 
-    string Function::encoded() const {
-        return "<Function>";
+    /* Comparisons, and the same comparison with its operands swapped */
+    static const map<string,string> SWAPPED = {
+        { "==", "==" }, { "!=", "!=" }, { "<", ">" }, { "<=", ">=" }, { ">", "<" }, { ">=", "<=" },
+    };
+
+    bool PredicateIndex::guard(size_t rule, LiteExprParser::ExprContext* expr, const std::set<string>& written) {
+        auto op = dynamic_cast<LiteExprParser::BinaryOpContext*>(expr);
+
+        if(!op || !SWAPPED.count(op->op->getText())) return false;
+
+        string optext = op->op->getText();
+        auto var = dynamic_cast<LiteExprParser::VariableContext*>(op->expr(0));
+        LiteExprParser::ExprContext* literal = op->expr(1);
+
+        if(!var) {
+            var = dynamic_cast<LiteExprParser::VariableContext*>(op->expr(1));
+            literal = op->expr(0);
+            optext = SWAPPED.at(optext);
+        }
+
+        if(!var || !is_path(var->varname(), written) || !is_literal(literal)) return false;
+
+        Guard guard{ rule, optext, any_cast<VALUE>(this->constants.visit(literal)) };
+        bool number = guard.constant->type() != typeid(String);
+        bool range = optext != "==" && optext != "!=";
+
+        if(range && !number) return false;
+
+        Path& path = this->paths[var->getText()];
+
+        if(!path.var) path.var = var;
+
+        if(optext == "<" || optext == "<=") path.upper.push_back({ guard.constant->dvalue(), guard });
+        else if(range) path.lower.push_back({ guard.constant->dvalue(), guard });
+        else if(number) path.numbers[guard.constant->dvalue()].push_back(guard);
+        else path.strings[guard.constant->svalue()].push_back(guard);
+
+        if(optext == "!=") path.unequal.push_back(guard);
+
+        path.rules.push_back(rule);
+        path.sorted = false;
+
+        return true;
     }
 
-    const type_info& Function::type() const {
-        return typeid(*this);
+    /* Add the next rule, and return how many guards it has */
+    size_t PredicateIndex::add(antlr4::ParserRuleContext* tree, const std::set<string>& written) {
+        auto file = dynamic_cast<LiteExprParser::FileContext*>(tree);
+        vector<LiteExprParser::ExprContext*> exprs;
+        size_t rule = this->counts.size();
+        size_t count = 0;
+
+        if(file && file->expr()) operands(file->expr(), "&&", exprs);
+
+        for(auto expr : exprs) {
+            if(!this->guard(rule, expr, written)) break;
+
+            count++;
+        }
+
+        this->counts.push_back(count);
+
+        return count;
     }
 
-    void Function::setStaticExpr(LiteExprParser::ExprContext* staticExpr) {
-        this->staticExpr = staticExpr;
+    bool PredicateIndex::holds(VALUE value, const Guard& guard) {
+        if(guard.op == "==") return value->op_eq(guard.constant)->istrue();
+        if(guard.op == "!=") return value->op_ne(guard.constant)->istrue();
+        if(guard.op == "<")  return value->op_lt(guard.constant)->istrue();
+        if(guard.op == "<=") return value->op_lte(guard.constant)->istrue();
+        if(guard.op == ">")  return value->op_gt(guard.constant)->istrue();
+
+        return value->op_gte(guard.constant)->istrue();
     }
-}
 
+    /* Which rules must be evaluated against the symbols */
+    vector<bool> PredicateIndex::match(SYMBOLS symbols) {
+        vector<size_t> matched(this->counts.size(), 0);
+        vector<bool> candidates(this->counts.size(), false);
+        Evaluator evaluator(symbols);
 
-/* ***************************************************************************
-* VARIABLE
-*/
+        for(auto& entry : this->paths) {
+            Path& path = entry.second;
+            VALUE value;
 
-namespace liteexpr {
-    Ident::Ident(VALUE container, VALUE key) {
-        this->container = container;
-        this->key = key;
-    }
+            try {
+                value = resolved(any_cast<VALUE>(evaluator.visit(path.var)));
+            }
+            catch(const Error&) {
+                value = nullptr;
+            }
 
-    Ident::~Ident() {
-        this->container = nullptr;
-        this->key = nullptr;
+            bool number = value && (value->type() == typeid(Integer) || value->type() == typeid(Double));
+            bool text = value && value->type() == typeid(String);
+            bool ranged = !path.lower.empty() || !path.upper.empty();
+
+            if(!number && !(text && !ranged)) {
+                for(size_t rule : path.rules) candidates[rule] = true;
+
+                continue;
+            }
+
+            /* Equal constants hash alike whatever their type; the comparison
+            * itself decides */
+            const vector<Guard>* equal = nullptr;
+
+            if(number) {
+                auto found = path.numbers.find(value->dvalue());
+
+                if(found != path.numbers.end()) equal = &found->second;
+            }
+            else {
+                auto found = path.strings.find(value->svalue());
+
+                if(found != path.strings.end()) equal = &found->second;
+            }
+
+            for(const Guard& guard : path.unequal) matched[guard.rule]++;
+
+            if(equal) {
+                for(const Guard& guard : *equal) {
+                    if(!value->op_eq(guard.constant)->istrue()) continue;
+
+                    if(guard.op == "==") matched[guard.rule]++;
+                    else matched[guard.rule]--;
+                }
+            }
+
+            if(!number || std::isnan(value->dvalue())) continue;
+
+            if(!path.sorted) {
+                auto byConstant = [](const pair<double,Guard>& a, const pair<double,Guard>& b) { return a.first < b.first; };
+
+                std::sort(path.lower.begin(), path.lower.end(), byConstant);
+                std::sort(path.upper.begin(), path.upper.end(), byConstant);
+                path.sorted = true;
+            }
+
+            /* Rounding to double keeps order, so no bound that holds is
+            * passed over */
+            double d = value->dvalue();
+
+            for(auto bound = path.lower.begin(); bound != path.lower.end() && bound->first <= d; bound++) {
+                if(holds(value, bound->second)) matched[bound->second.rule]++;
+            }
+
+            for(auto bound = path.upper.rbegin(); bound != path.upper.rend() && bound->first >= d; bound++) {
+                if(holds(value, bound->second)) matched[bound->second.rule]++;
+            }
+        }
+
+        for(size_t rule = 0; rule < this->counts.size(); rule++) {
+            candidates[rule] = candidates[rule] || matched[rule] == this->counts[rule];
+        }
+
+        return candidates;
     }
 
-    void Ident::set(VALUE other) {
-        if(this->container->type() == typeid(Array)) {
-            ARRAY array = dynamic_pointer_cast<Array>(this->container);
+    /*
+    * Compile the rules and find the subexpressions they share.  Nothing is
+    * shared or indexed if any rule uses EVAL, UPSCOPE or GLOBAL, since it may
+    * write any symbol.
+    */
+    RuleSet::RuleSet(const vector<string>& sources, bool indexed) {
+        std::set<string> written;
+        bool unknown = false;
 
-            array->set(this->key->ivalue(), other);
-            return;
+        for(const string& source : sources) {
+            shared_ptr<Compiled> rule(new Compiled(source));
+            Dependencies deps = rule->dependencies();
+
+            for(const string& path : deps.writes) written.insert(path_symbol(path));
+            unknown = unknown || deps.unknown;
+
+            for(const string& path : deps.calls) {
+                if(!builtins.count(path)) this->functions.push_back(path_names(path));
+            }
+
+            this->rules.push_back(rule);
         }
 
-        if(this->container->type() == typeid(Object) || this->container->type() == typeid(SymbolTable)) {
-            OBJECT object = dynamic_pointer_cast<Object>(this->container);
+        if(unknown) return;
 
-            object->set(this->key->svalue(), other);
-            return;
+        if(indexed) {
+            this->index.reset(new PredicateIndex());
+
+            for(auto& rule : this->rules) this->indexing.guards += this->index->add(rule->parseTree, written);
         }
 
-        throw BasicRuntimeError(string("Invalid identifier set type: ") + this->container->type().name());
+        SubtreeNumbering numbering(written);
+
+        for(auto& rule : this->rules) {
+            bool pure;
+
+            numbering.number(rule->parseTree, pure);
+        }
+
+        for(const auto& candidate : numbering.candidates) {
+            if(candidate.second.size() < 2) continue;
+
+            for(auto node : candidate.second) this->slots[node] = this->sharing.subexpressions;
+
+            this->sharing.subexpressions++;
+            this->sharing.occurrences += candidate.second.size();
+        }
     }
 
-    VALUE Ident::get() const {
-        if(this->container->type() == typeid(Array)) {
-            ARRAY array = dynamic_pointer_cast<Array>(this->container);
-            VALUE value = array->get(this->key->ivalue());
+    size_t RuleSet::size() const {
+        return this->rules.size();
+    }
 
-            return value;
+    /* Whether every function the rules call is a pure host function, so no
+    * rule can change the symbols another one reads but through assignments */
+    bool RuleSet::pure(SYMBOLS symbols) const {
+        for(const vector<string>& names : this->functions) {
+            FUNCTION function = dynamic_pointer_cast<Function>(resolved(path_value(symbols, names)));
+
+            if(!function || !function->isPure()) return false;
         }
 
-        if(this->container->type() == typeid(Object) || this->container->type() == typeid(SymbolTable)) {
-            OBJECT object = dynamic_pointer_cast<Object>(this->container);
-            VALUE value = object->get(this->key->svalue());
+        return true;
+    }
 
-            return value;
+    /*
+    * Evaluate every rule in order and return their results.  The limits on
+    * steps and time apply to each rule; those on memory to the whole set.
+    * Rules whose guards don't match are 0, as if they had been evaluated.
+    * Guards are decided before any rule runs, so they are not used when a
+    * rule calls a function that isn't pure.  Such a function may write any
+    * symbol, so nothing is shared either.
+    */
+    vector<VALUE> RuleSet::eval(SYMBOLS symbols, const Limits& limits) {
+        std::unique_ptr<Meter> metered(limits.memory || limits.usage ? new Meter(limits) : nullptr);
+        Evaluator::Shared shared{ this->slots, vector<VALUE>(this->sharing.subexpressions), 0, 0 };
+        bool pure = this->pure(symbols);
+        bool indexed = this->index && pure;
+        vector<bool> candidates = indexed ? this->index->match(symbols) : vector<bool>();
+        vector<VALUE> results;
+
+        results.reserve(this->rules.size());
+
+        for(size_t i = 0; i < this->rules.size(); i++) {
+            auto& rule = this->rules[i];
+
+            if(indexed && !candidates[i]) {
+                results.push_back(VALUE(new Integer(0)));
+                this->indexing.skipped++;
+
+                continue;
+            }
+
+            if(this->index) this->indexing.evaluated++;
+
+            Evaluator evaluator(symbols, limits);
+
+            evaluator.source = rule->source;
+            evaluator.shared = (this->slots.empty() || !pure) ? nullptr : &shared;
+
+            results.push_back(any_cast<VALUE>(evaluator.visit(rule->parseTree)));
         }
 
-        throw BasicRuntimeError(string("Invalid identifier get type: ") + this->container->type().name());
+        this->sharing.evaluated += shared.evaluated;
+        this->sharing.reused += shared.reused;
+
+        return results;
     }
 
-    VALUE Ident::getkey() const {
-        return this->key;
+    const Sharing& RuleSet::getSharing() const {
+        return this->sharing;
     }
 
-    string Ident::name() const { return this->get()->name(); }
-    string Ident::encoded() const { return this->get()->encoded(); }
-    const type_info& Ident::type() const { return this->get()->type(); }
-    bool Ident::istrue() const { return this->get()->istrue(); }
-    int64_t Ident::length() const { return this->get()->length(); }
-    int64_t Ident::ivalue() const { return this->get()->ivalue(); }
-    double Ident::dvalue() const { return this->get()->dvalue(); }
-    string Ident::svalue() const { return this->get()->svalue(); }
-    const vector<VALUE>& Ident::avalue() const { return this->get()->avalue(); }
-    const map<string,VALUE>& Ident::ovalue() const { return this->get()->ovalue(); }
-    VALUE Ident::op_not() const { return this->get()->op_not(); }
-    VALUE Ident::op_inv() const { return this->get()->op_inv(); }
-    VALUE Ident::op_pos() const { return this->get()->op_pos(); }
-    VALUE Ident::op_neg() const { return this->get()->op_neg(); }
-    VALUE Ident::op_inc() const { return this->get()->op_inc(); }
-    VALUE Ident::op_dec() const { return this->get()->op_dec(); }
-    VALUE Ident::op_lt(const VALUE other) const { return this->get()->op_lt(other); }
-    VALUE Ident::op_gt(const VALUE other) const { return this->get()->op_gt(other); }
-    VALUE Ident::op_eq(const VALUE other) const { return this->get()->op_eq(other); }
-    VALUE Ident::op_ne(const VALUE other) const { return this->get()->op_ne(other); }
-    VALUE Ident::op_lte(const VALUE other) const { return this->get()->op_lte(other); }
-    VALUE Ident::op_gte(const VALUE other) const { return this->get()->op_gte(other); }
-    VALUE Ident::op_pow(const VALUE other) const { return this->get()->op_pow(other); }
-    VALUE Ident::op_mul(const VALUE other) const { return this->get()->op_mul(other); }
-    VALUE Ident::op_div(const VALUE other) const { return this->get()->op_div(other); }
-    VALUE Ident::op_add(const VALUE other) const { return this->get()->op_add(other); }
-    VALUE Ident::op_sub(const VALUE other) const { return this->get()->op_sub(other); }
-    VALUE Ident::op_mod(const VALUE other) const { return this->get()->op_mod(other); }
-    VALUE Ident::op_shl(const VALUE other) const { return this->get()->op_shl(other); }
-    VALUE Ident::op_asr(const VALUE other) const { return this->get()->op_asr(other); }
-    VALUE Ident::op_shr(const VALUE other) const { return this->get()->op_shr(other); }
-    VALUE Ident::op_and(const VALUE other) const { return this->get()->op_and(other); }
-    VALUE Ident::op_xor(const VALUE other) const { return this->get()->op_xor(other); }
-    VALUE Ident::op_or(const VALUE other) const { return this->get()->op_or(other); }
+    const Indexing& RuleSet::getIndexing() const {
+        return this->indexing;
+    }
 }
 
 
 /* ***************************************************************************
-* EVALUATOR
+* EXCEPTIONS
 */
 
 namespace liteexpr {
-    typedef pair<string,VALUE> Pair;
-    typedef vector<Pair> PairList;
-    typedef vector<VALUE> List;
+    Error::Error(const string& t): Error(ErrorCode::GENERIC, t) {
+    }
 
-    Evaluator::Evaluator(SYMBOLS s) {
-        this->symbols = s;
+    Error::Error(const string& t, int line): Error(ErrorCode::GENERIC, t, line) {
     }
 
-    SYMBOLS Evaluator::getSymbols() {
-        return this->symbols;
+    Error::Error(const string& t, int line, int col): Error(ErrorCode::GENERIC, t, line, col) {
     }
 
-    any Evaluator::visitFile(LiteExprParser::FileContext *ctx) {
-        any result = VALUE(new Integer(0));
+    Error::Error(ErrorCode code, const string& t, int line, int col) {
+        this->code = code;
+        this->op = nullptr;
+        this->text = t;
+        this->line = line;
+        this->col = col;
+        this->context = nullptr;
+    }
 
-        if(ctx->expr()) {
-            result = this->visit(ctx->expr());
-        }
+    Error::Error(ErrorCode code, const char* op, const string& a, const string& b) {
+        this->code = code;
+        this->op = op;
+        this->operands[0] = a;
+        this->operands[1] = b;
+        this->line = 0;
+        this->col = -1;
+        this->context = nullptr;
+    }
 
-        return result;
+    /* The same error, located; context names the kind of error it becomes
+    * when it happened while executing the call at span. */
+    Error::Error(const Error& e, int line, int col, const char* context, const Span& span): Error(e) {
+        this->line = line;
+        this->col = col;
+        this->context = context;
+        this->span = span;
     }
 
-    any Evaluator::visitString(LiteExprParser::StringContext *ctx) {
-        if(!this->cache.count(ctx)) {
-            try {
-                this->cache[ctx] = VALUE(new String(String::decode(ctx->STRING()->getText())));
-            }
-            catch(BasicSyntaxError e) {
-                throw SyntaxError(string(e), ctx->start->getLine(), ctx->start->getCharPositionInLine());
-            }
-        }
+    ErrorCode Error::getCode() const {
+        return this->code;
+    }
+
+    /* The operator or operation that failed, if any */
+    const char* Error::getOperator() const {
+        return this->op;
+    }
 
-        return this->cache[ctx];
+    /* The operands' types, or their values for arithmetic errors */
+    const string& Error::getOperand(size_t i) const {
+        return this->operands[i];
     }
 
-    any Evaluator::visitDouble(LiteExprParser::DoubleContext *ctx) {
-        if(!this->cache.count(ctx)) {
-            try {
-                this->cache[ctx] = VALUE(new Double(Double::decode(ctx->DOUBLE()->getText())));
-            }
-            catch(BasicSyntaxError e) {
-                throw SyntaxError(string(e), ctx->start->getLine(), ctx->start->getCharPositionInLine());
-            }
-        }
+    /* 0 if not known */
+    int Error::getLine() const {
+        return this->line;
+    }
 
-        return this->cache[ctx];
+    /* 1-based, 0 if not known */
+    int Error::getColumn() const {
+        return this->col + 1;
     }
 
-    any Evaluator::visitHex(LiteExprParser::HexContext *ctx) {
-        if(!this->cache.count(ctx)) {
-            try {
-                string encoded = ctx->HEX()->getText();
-                this->cache[ctx] = VALUE(new Integer(Integer::decodeHex(encoded.substr(2))));
+    /* The call that was executing, if any */
+    const Span& Error::getSpan() const {
+        return this->span;
+    }
+
+    /* The source as the parser saw it, without whitespace or comments */
+    static string compact(const string& source, size_t start, size_t stop) {
+        string text;
+        size_t i = start;
+
+        while(i < stop) {
+            char c = source[i];
+
+            if(c == ' ' || c == '\t' || c == '\r' || c == '\n') {
+                i++;
             }
-            catch(BasicSyntaxError e) {
-                throw SyntaxError(string(e), ctx->start->getLine(), ctx->start->getCharPositionInLine());
+            else if(c == '#') {
+                while(i < stop && source[i] != '\n') i++;
             }
-        }
+            else if(c == '/' && i+1 < stop && source[i+1] == '*') {
+                size_t end = source.find("*/", i+2);
 
-        return this->cache[ctx];
-    }
+                i = (end == string::npos || end+2 > stop) ? stop : end+2;
+            }
+            else if(c == '"') {
+                text += source[i++];
 
-    any Evaluator::visitInt(LiteExprParser::IntContext *ctx) {
-        if(!this->cache.count(ctx)) {
-            try {
-                this->cache[ctx] = VALUE(new Integer(Integer::decode(ctx->INT()->getText())));
+                while(i < stop && source[i] != '"') {
+                    if(source[i] == '\\' && i+1 < stop && (source[i+1] == '\\' || source[i+1] == '"')) text += source[i++];
+                    text += source[i++];
+                }
+
+                if(i < stop) text += source[i++];
             }
-            catch(BasicSyntaxError e) {
-                throw SyntaxError(string(e), ctx->start->getLine(), ctx->start->getCharPositionInLine());
+            else {
+                text += source[i++];
             }
         }
 
-        return this->cache[ctx];
+        return text;
     }
 
-    any Evaluator::visitArray(LiteExprParser::ArrayContext *ctx) {
-        List result = any_cast<List>(this->visit(ctx->list()));
+    /* The message without its location */
+    string Error::message() const {
+        const string& a = this->operands[0];
+        const string& b = this->operands[1];
 
-        return VALUE(new Array(result));
-    }
+        switch(this->code) {
+            case ErrorCode::UNKNOWN_SYMBOL:
+                if(this->text.empty()) return a + " is not a valid symbol";
+                break;
 
-    any Evaluator::visitObject(LiteExprParser::ObjectContext *ctx) {
-        PairList plist = any_cast<PairList>(this->visit(ctx->pairlist()));
-        map<string,VALUE> result;
+            case ErrorCode::UNSUPPORTED_OPERATION:
+                return string("Unsupported operation `") + this->op + "`: " + a;
 
-        for(const Pair& pi: plist) {
-            string k = pi.first;
-            VALUE v = pi.second;
+            case ErrorCode::UNSUPPORTED_OPERAND:
+                return string("Unsupported operand type for `") + this->op + "`: (" + a + ")";
 
-            result[k] = v;
-        }
+            case ErrorCode::UNSUPPORTED_OPERANDS:
+                return string("Unsupported operand type(s) for `") + this->op + "`: (" + a + "," + (b.empty() ? "*" : b) + ")";
 
-        return VALUE(new Object(result));
-    }
+            case ErrorCode::UNSUPPORTED_ARGUMENT:
+                if(this->op) return string("Unsupported argument to `") + this->op + "`: (" + a + ")";
+                break;
 
-    any Evaluator::visitPairlist(LiteExprParser::PairlistContext *ctx) {
-        PairList plist;
+            case ErrorCode::DIVISION_BY_ZERO:
+                return "Division by zero: (" + a + " / " + b + ")";
 
-        for(LiteExprParser::PairContext* pc: ctx->pair()) {
-            Pair p = any_cast<Pair>(this->visit(pc));
+            case ErrorCode::MODULUS_BY_ZERO:
+                return "Modulus by zero: (" + a + " % " + b + ")";
 
-            plist.push_back(p);
+            case ErrorCode::NEGATIVE_SHIFT:
+                return string("Invalid attempt to shift `") + this->op + "` by a negative amount: " + b;
+
+            case ErrorCode::INDEX_OUT_OF_RANGE:
+                return "Array index `" + a + "` out of range, expected " + this->op + " " + b;
+
+            default:
+                break;
         }
 
-        return plist;
+        return this->text;
     }
 
-    any Evaluator::visitPair(LiteExprParser::PairContext *ctx) {
-        string k = ctx->ID()->getText();
-        VALUE v = any_cast<VALUE>(this->visit(ctx->expr()));
+    Error::operator string() const {
+        string text = this->message();
 
-        return Pair(k,v);
-    }
+        if(this->context) {
+            string call = this->span.source ? compact(*this->span.source, this->span.start, this->span.stop) : string();
 
-    any Evaluator::visitList(LiteExprParser::ListContext *ctx) {
-        List result;
+            text = string(this->context) + " error while executing `" + call + "`:\n" + text;
+        }
 
-        for(LiteExprParser::ExprContext* expr: ctx->expr()) {
-            result.push_back(any_cast<VALUE>(this->visit(expr)));
+        if(this->line && this->col >= 0) {
+            text = "[line " + to_string(this->line) + ", col " + to_string(this->col+1) + "] " + text;
+        }
+        else if(this->line) {
+            text = "[line " + to_string(this->line) + "] " + text;
         }
 
-        return result;
+        return text;
     }
+}
 
-    any Evaluator::visitCall(LiteExprParser::CallContext *ctx) {
-        VALUE varname = any_cast<VALUE>(this->visit(ctx->varname()));
-        IDENT ident = dynamic_pointer_cast<Ident>(varname);
-        VALUE value;
 
-        try {
-            value = ident->get();
-        }
-        catch(std::out_of_range e) {
-            throw RuntimeError(ident->getkey()->svalue() + " is not a valid symbol", ctx->start->getLine(), ctx->start->getCharPositionInLine());
-        }
+/* ***************************************************************************
+* BUILT-INS
+*/
 
-        FUNCTION fnname = dynamic_pointer_cast<Function>(value);
-        vector<LiteExprParser::ExprContext*> vexpr = ctx->list()->expr();
+namespace liteexpr {
+    static VALUE builtin_ceil(const vector<VALUE>& vv) {
+        VALUE v = vv[0];
 
-        try {
-            VALUE result = fnname->call(vexpr, this);
+        if(v->type() == typeid(Integer))                           return VALUE(new Integer(ceil(v->dvalue())));
+        if(v->type() == typeid(Double) && std::isnan(v->dvalue())) return VALUE(new Double(0.0/0.0));
+        if(v->type() == typeid(Double) && std::isinf(v->dvalue())) return v->dvalue() < 0 ? VALUE(new Double(-1.0/0.0)) : VALUE(new Double(1.0/0.0));
+        if(v->type() == typeid(Double) && v->dvalue() > MAXINT)    return VALUE(new Double(ceil(v->dvalue())));
+        if(v->type() == typeid(Double) && v->dvalue() < MININT)    return VALUE(new Double(ceil(v->dvalue())));
+        if(v->type() == typeid(Double))                            return VALUE(new Integer(ceil(v->dvalue())));
 
-            return result;
-        }
-        catch(BasicRuntimeError e) {
-            throw RuntimeError("Runtime error while executing `" + ctx->getText()  + "`:\n" + string(e), ctx->start->getLine(), ctx->start->getCharPositionInLine());
-        }
-        catch(BasicSyntaxError e) {
-            throw SyntaxError("Syntax error while executing `" + ctx->getText()  + "`:\n" + string(e), ctx->start->getLine(), ctx->start->getCharPositionInLine());
-        }
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_ARGUMENT, "CEIL()", v->name());
     }
 
-    any Evaluator::visitParen(LiteExprParser::ParenContext *ctx) {
-        return this->visit(ctx->expr());
-    }
+    static VALUE builtin_eval(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor) {
+        VALUE v = any_cast<VALUE>(visitor->visit(vexpr[0]));
 
-    any Evaluator::visitPrefixOp(LiteExprParser::PrefixOpContext *ctx) {
-        string op = ctx->op->getText();
-        VALUE left = any_cast<VALUE>(this->visit(ctx->varname()));
-        IDENT lvalue = dynamic_pointer_cast<Ident>(left);
-        VALUE result;
+        if(v->type() == typeid(String)) {
+            Compiled compiled = compile(v->svalue());
 
-        try {
-            if     (op == "++") result = left->op_inc();
-            else if(op == "--") result = left->op_dec();
-            else throw SyntaxError("Unknown prefix operator `" + op + "`", ctx->op->getLine(), ctx->op->getCharPositionInLine());
-        }
-        catch(BasicRuntimeError e) {
-            throw RuntimeError(string(e), ctx->op->getLine(), ctx->op->getCharPositionInLine());
+            return compiled.eval(visitor);
         }
 
-        lvalue->set(result);
-
-        return left;
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_ARGUMENT, "EVAL()", v->name());
     }
 
-    any Evaluator::visitPostfixOp(LiteExprParser::PostfixOpContext *ctx) {
-        string op = ctx->op->getText();
-        VALUE left = any_cast<VALUE>(this->visit(ctx->varname()));
-        IDENT lvalue = dynamic_pointer_cast<Ident>(left);
-        VALUE last = lvalue->get();
-        VALUE result;
-
-        try {
-            if     (op == "++") result = left->op_inc();
-            else if(op == "--") result = left->op_dec();
-            else throw SyntaxError("Unknown postfix operator `" + op + "`", ctx->op->getLine(), ctx->op->getCharPositionInLine());
-        }
-        catch(BasicRuntimeError e) {
-            throw RuntimeError(string(e), ctx->op->getLine(), ctx->op->getCharPositionInLine());
-        }
+    static VALUE builtin_floor(const vector<VALUE>& vv) {
+        VALUE v = vv[0];
 
-        lvalue->set(result);
+        if(v->type() == typeid(Integer))                           return VALUE(new Integer(floor(v->dvalue())));
+        if(v->type() == typeid(Double) && std::isnan(v->dvalue())) return VALUE(new Double(0.0/0.0));
+        if(v->type() == typeid(Double) && std::isinf(v->dvalue())) return v->dvalue() < 0 ? VALUE(new Double(-1.0/0.0)) : VALUE(new Double(1.0/0.0));
+        if(v->type() == typeid(Double) && v->dvalue() > MAXINT)    return VALUE(new Double(floor(v->dvalue())));
+        if(v->type() == typeid(Double) && v->dvalue() < MININT)    return VALUE(new Double(floor(v->dvalue())));
+        if(v->type() == typeid(Double))                            return VALUE(new Integer(floor(v->dvalue())));
 
-        return last;
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_ARGUMENT, "FLOOR()", v->name());
     }
 
-    any Evaluator::visitUnaryOp(LiteExprParser::UnaryOpContext *ctx) {
-        string op = ctx->op->getText();
-        VALUE value = any_cast<VALUE>(this->visit(ctx->expr()));
-        VALUE result;
+    /* A loop test of the form `i < b` or `i <= b`, where `b` is a numeric
+    * literal, a variable, or `LEN()` of a variable, is evaluated natively
+    * without building identifiers or boxing the intermediate results. */
 
-        try {
-            if     (op == "!") result = value->op_not();
-            else if(op == "~") result = value->op_inv();
-            else if(op == "+") result = value->op_pos();
-            else if(op == "-") result = value->op_neg();
-            else throw SyntaxError(string("Unknown unary operator `") + op + "`", ctx->op->getLine(), ctx->op->getCharPositionInLine());
-        }
-        catch(BasicRuntimeError e) {
-            throw RuntimeError(string(e), ctx->op->getLine(), ctx->op->getCharPositionInLine());
-        }
+    struct LoopTest {
+        string counter;
+        string bound;
+        VALUE limit;
+        bool len = false;
+        bool inclusive = false;
+    };
 
-        return result;
-    }
+    static string simple_name(LiteExprParser::VarnameContext* varname) {
+        LiteExprParser::SimpleVarContext* simple = dynamic_cast<LiteExprParser::SimpleVarContext*>(varname);
 
-    any Evaluator::visitBinaryOp(LiteExprParser::BinaryOpContext *ctx) {
-        string op = ctx->op->getText();
-        VALUE left = any_cast<VALUE>(this->visit(ctx->expr(0)));
-        antlr4::tree::ParseTree* rexpr = ctx->expr(1);
-        VALUE result;
+        return simple ? simple->ID()->getText() : string();
+    }
 
-        try {
-            if     (op == "**")  result = left->op_pow(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "*")   result = left->op_mul(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "/")   result = left->op_div(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "%")   result = left->op_mod(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "+")   result = left->op_add(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "-")   result = left->op_sub(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "<<")  result = left->op_shl(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == ">>")  result = left->op_asr(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == ">>>") result = left->op_shr(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "<")   result = left->op_lt(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == ">")   result = left->op_gt(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "==")  result = left->op_eq(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "!=")  result = left->op_ne(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "<=")  result = left->op_lte(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == ">=")  result = left->op_gte(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "|")   result = left->op_or(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "^")   result = left->op_xor(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "&")   result = left->op_and(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "||")  result = left->istrue() ? left : any_cast<VALUE>(this->visit(rexpr));
-            else if(op == "&&")  result = left->istrue() ? any_cast<VALUE>(this->visit(rexpr)) : left;
-            else if(op == ";")   result = any_cast<VALUE>(this->visit(rexpr));
-            else throw SyntaxError("Unknown binary operator `" + op + "`", ctx->op->getLine(), ctx->op->getCharPositionInLine());
-        }
-        catch(BasicRuntimeError e) {
-            throw RuntimeError(string(e), ctx->op->getLine(), ctx->op->getCharPositionInLine());
-        }
+    static string simple_var(LiteExprParser::ExprContext* expr) {
+        LiteExprParser::VariableContext* var = dynamic_cast<LiteExprParser::VariableContext*>(expr);
 
-        return result;
+        return var ? simple_name(var->varname()) : string();
     }
 
-    any Evaluator::visitTernaryOp(LiteExprParser::TernaryOpContext *ctx) {
-        string op1 = ctx->op1->getText();
-        string op2 = ctx->op2->getText();
-        VALUE left = any_cast<VALUE>(this->visit(ctx->expr(0)));
-        antlr4::tree::ParseTree* expr1 = ctx->expr(1);
-        antlr4::tree::ParseTree* expr2 = ctx->expr(2);
-        VALUE result;
+    static bool loop_test(LiteExprParser::ExprContext* expr, Evaluator* visitor, LoopTest& test) {
+        LiteExprParser::BinaryOpContext* cond = dynamic_cast<LiteExprParser::BinaryOpContext*>(expr);
 
-        try {
-            if (op1 == "?" && op2 == ":") {
-                result = left->istrue() ? any_cast<VALUE>(this->visit(expr1)) : any_cast<VALUE>(this->visit(expr2));
-            }
-            else throw SyntaxError("Unknown ternary operator `" + op1 + " " + op2 + "`", ctx->op1->getLine(), ctx->op1->getCharPositionInLine());
-        }
-        catch(BasicRuntimeError e) {
-            throw RuntimeError(string(e), ctx->op1->getLine(), ctx->op1->getCharPositionInLine());
-        }
+        if(!cond) return false;
 
-        return result;
-    }
+        string op = cond->op->getText();
+        LiteExprParser::ExprContext* right = cond->expr(1);
+        LiteExprParser::CallContext* call = dynamic_cast<LiteExprParser::CallContext*>(right);
 
-    any Evaluator::visitAssignOp(LiteExprParser::AssignOpContext *ctx) {
-        string op = ctx->op->getText();
-        VALUE left = any_cast<VALUE>(this->visit(ctx->varname()));
-        IDENT lvalue = dynamic_pointer_cast<Ident>(left);
-        antlr4::tree::ParseTree* rexpr = ctx->expr();
-        VALUE result;
+        if(op != "<" && op != "<=") return false;
 
-        try {
-            if     (op == "=")    result = any_cast<VALUE>(this->visit(rexpr));
-            else if(op == "**=")  result = left->op_pow(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "*=")   result = left->op_mul(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "/=")   result = left->op_div(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "%=")   result = left->op_mod(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "+=")   result = left->op_add(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "-=")   result = left->op_sub(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "<<=")  result = left->op_shl(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == ">>=")  result = left->op_asr(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == ">>>=") result = left->op_shr(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "|=")   result = left->op_or(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "^=")   result = left->op_xor(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "&=")   result = left->op_and(any_cast<VALUE>(this->visit(rexpr)));
-            else if(op == "||=")  result = left->istrue() ? left : any_cast<VALUE>(this->visit(rexpr));
-            else if(op == "&&=")  result = left->istrue() ? any_cast<VALUE>(this->visit(rexpr)) : left;
-            else throw SyntaxError("Unknown assignment operator `" + op + "`", ctx->op->getLine(), ctx->op->getCharPositionInLine());
-        }
-        catch(BasicRuntimeError e) {
-            throw RuntimeError(string(e), ctx->op->getLine(), ctx->op->getCharPositionInLine());
-        }
+        test.counter = simple_var(cond->expr(0));
+        test.inclusive = (op == "<=");
 
-        lvalue->set(result);
+        if(test.counter.empty()) return false;
 
-        return left;
-    }
+        if(dynamic_cast<LiteExprParser::IntContext*>(right) || dynamic_cast<LiteExprParser::HexContext*>(right) || dynamic_cast<LiteExprParser::DoubleContext*>(right)) {
+            test.limit = any_cast<VALUE>(visitor->visit(right));
+        }
+        else if(call) {
+            vector<LiteExprParser::ExprContext*> args = call->list()->expr();
 
-    any Evaluator::visitVariable(LiteExprParser::VariableContext *ctx) {
-        return this->visit(ctx->varname());
-    }
+            if(simple_name(call->varname()) != "LEN" || args.size() != 1) return false;
 
-    any Evaluator::visitMemberVar(LiteExprParser::MemberVarContext *ctx) {
-        IDENT name = dynamic_pointer_cast<Ident>(any_cast<VALUE>(this->visit(ctx->varname(0))));
-        IDENT value = dynamic_pointer_cast<Ident>(any_cast<VALUE>(this->visit(ctx->varname(1))));
+            test.bound = simple_var(args[0]);
+            test.len = true;
+        }
+        else {
+            test.bound = simple_var(right);
+        }
 
-        return VALUE(new Ident(name->get(), value->getkey()));
+        return test.limit || !test.bound.empty();
     }
 
-    any Evaluator::visitIndexedVar(LiteExprParser::IndexedVarContext *ctx) {
-        IDENT name = dynamic_pointer_cast<Ident>(any_cast<VALUE>(this->visit(ctx->varname())));
-        VALUE value = any_cast<VALUE>(this->visit(ctx->expr()));
-
-        return VALUE(new Ident(name->get(), value));
-    }
+    static string loop_step(LiteExprParser::ExprContext* expr) {
+        LiteExprParser::PostfixOpContext* postfix = dynamic_cast<LiteExprParser::PostfixOpContext*>(expr);
+        LiteExprParser::PrefixOpContext* prefix = dynamic_cast<LiteExprParser::PrefixOpContext*>(expr);
 
-    any Evaluator::visitSimpleVar(LiteExprParser::SimpleVarContext *ctx) {
-        string name = ctx->ID()->getText();
+        if(postfix && postfix->op->getText() == "++") return simple_name(postfix->varname());
+        if(prefix && prefix->op->getText() == "++") return simple_name(prefix->varname());
 
-        return VALUE(new Ident(this->symbols, VALUE(new String(name))));
+        return string();
     }
 
-    any Evaluator::visitTerm(LiteExprParser::TermContext *ctx) {
-        return this->visit(ctx->expr());
-    }
+    /* Returns 1 or 0, or -1 if the test must be evaluated generically. */
+    static int run_loop_test(const LoopTest& test, SYMBOLS symbols) {
+        VALUE counter;
+        VALUE bound = test.limit;
+        int64_t length = 0;
 
+        counter = symbols->find(test.counter);
+        if(!bound) bound = symbols->find(test.bound);
 
-    /* ***************************************************************************
-    * COMPILED
-    */
+        if(!counter || !bound) return -1;
+        if(counter->type() != typeid(Integer) && counter->type() != typeid(Double)) return -1;
 
-    Compiled::Compiled(string expr) {
-        this->input = new antlr4::ANTLRInputStream(expr);
-        this->lexer = new LiteExprLexer(this->input);
+        if(test.len) {
+            if(!is_builtin(symbols->find("LEN"), "LEN")) return -1;
 
-        this->tokens = new antlr4::CommonTokenStream(this->lexer);
-        this->parser = new LiteExprParser(this->tokens);
+            try {
+                length = bound->length();
+            }
+            catch(const BasicRuntimeError& e) {
+                return -1;
+            }
 
-        this->parser->setErrorHandler(std::make_shared<antlr4::BailErrorStrategy>());
+            if(counter->type() == typeid(Integer)) {
+                return test.inclusive ? counter->ivalue() <= length : counter->ivalue() < length;
+            }
 
-        try {
-            this->parseTree = this->parser->file();
+            return test.inclusive ? counter->dvalue() <= length : counter->dvalue() < length;
         }
-        catch(antlr4::ParseCancellationException e) {
-            const antlr4::Token* token = this->parser->getCurrentToken();
-            string message = string("Unexpected token `") + token->getText() + "`";
-            int line = token->getLine();
-            int col = token->getCharPositionInLine();
 
-            throw SyntaxError(message, line, col);
+        if(counter->type() == typeid(Integer) && bound->type() == typeid(Integer)) {
+            return test.inclusive ? counter->ivalue() <= bound->ivalue() : counter->ivalue() < bound->ivalue();
         }
-    }
-
-    Compiled::~Compiled() {
-        if(this->parser) delete(this->parser);
-        if(this->tokens) delete(this->tokens);
-        if(this->lexer) delete(this->lexer);
-        if(this->input) delete(this->input);
 
-        this->parser = nullptr;
-        this->tokens = nullptr;
-        this->lexer = nullptr;
-        this->input = nullptr;
-    }
-
-    VALUE Compiled::eval(SYMBOLS symbols) {
-        Evaluator evaluator(symbols);
-        any result = evaluator.visit(this->parseTree);
+        if(bound->type() == typeid(Integer) || bound->type() == typeid(Double)) {
+            return test.inclusive ? counter->dvalue() <= bound->dvalue() : counter->dvalue() < bound->dvalue();
+        }
 
-        return any_cast<VALUE>(result);
+        return -1;
     }
 
-    /* ***************************************************************************
-    * PUBLIC FUNCTIONS
+    /*
+    * Whether a loop body can see or change any of names: it mentions one,
+    * reaches the scope through UPSCOPE or GLOBAL, or calls EVAL, a closure,
+    * or a host function that isn't pure.
     */
+    static bool observes(antlr4::tree::ParseTree* node, const std::set<string>& names, SYMBOLS symbols) {
+        if(auto var = dynamic_cast<LiteExprParser::SimpleVarContext*>(node)) {
+            string name = var->ID()->getText();
 
-    Compiled compile(const string& expr) {
-        return Compiled(expr);
-    }
-
-    VALUE eval(const string& expr, SYMBOLS symbols) {
-        Compiled compiled = compile(expr);
-        VALUE result = compiled.eval(symbols);
+            return names.count(name) || name == "UPSCOPE" || name == "GLOBAL";
+        }
 
-        return result;
-    }
-}
+        if(auto call = dynamic_cast<LiteExprParser::CallContext*>(node)) {
+            string name = simple_name(call->varname());
+            VALUE value = name.empty() ? nullptr : resolved(symbols->find(name));
+            FUNCTION function = dynamic_pointer_cast<Function>(value);
 
+            if(is_builtin(value, name)) {
+                if(name == "EVAL") return true;
+            }
+            else if(!function || function->isClosure() || !function->isPure()) return true;
+        }
 
-/* ***************************************************************************
-* EXCEPTIONS
-*/
+        for(auto child : node->children) {
+            if(observes(child, names, symbols)) return true;
+        }
 
-namespace liteexpr {
-    Error::Error(const string& t) {
-        this->text = t;
+        return false;
     }
 
-    Error::Error(const string& t, int line) {
-        this->text = "[line " + to_string(line) + "] " + t;
-    }
+    /*
+    * FOR(i = a, i < b, i++, ...) with an integer counter the body can't see,
+    * and a bound it can't change unless it is LEN() of an array: the counter
+    * is kept in a local and written back when the loop ends or fails.
+    * Returns whether the loop ran to its end; if not, the counter has been
+    * written back and the loop continues on the generic path.
+    */
+    static bool local_loop(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor, const LoopTest& test, VALUE& result) {
+        SYMBOLS symbols = visitor->getSymbols();
+        VALUE counter = symbols->find(test.counter);
+        VALUE bound = test.limit ? test.limit : symbols->find(test.bound);
+        std::set<string> names = { test.counter };
 
-    Error::Error(const string& t, int line, int col) {
-        this->text = "[line " + to_string(line) + ", col " + to_string(col+1) + "] " + t;
-    };
-}
+        if(!test.bound.empty()) names.insert(test.bound);
+        if(test.len) names.insert("LEN");
 
+        if(!counter || !bound || counter->type() != typeid(Integer) || test.bound == test.counter) return false;
+        if(test.len ? !is_builtin(symbols->find("LEN"), "LEN") : bound->type() != typeid(Integer) && bound->type() != typeid(Double)) return false;
+        if(observes(vexpr[3], names, symbols)) return false;
 
-/* ***************************************************************************
-* BUILT-INS
-*/
+        bool integer = !test.len && bound->type() == typeid(Integer);
+        int64_t limit = integer ? bound->ivalue() : 0;
+        double dlimit = (integer || test.len) ? 0 : bound->dvalue();
+        int64_t i = counter->ivalue();
 
-namespace liteexpr {
-    static VALUE builtin_ceil(const vector<VALUE>& vv) {
-        VALUE v = vv[0];
+        try {
+            while(true) {
+                bool more;
+
+                if(test.len) {
+                    try {
+                        limit = symbols->find(test.bound)->length();
+                    }
+                    catch(const BasicRuntimeError& e) {
+                        symbols->set(test.counter, VALUE(new Integer(i)));
+
+                        return false;
+                    }
+                }
 
-        if(v->type() == typeid(Integer))                           return VALUE(new Integer(ceil(v->dvalue())));
-        if(v->type() == typeid(Double) && std::isnan(v->dvalue())) return VALUE(new Double(0.0/0.0));
-        if(v->type() == typeid(Double) && std::isinf(v->dvalue())) return v->dvalue() < 0 ? VALUE(new Double(-1.0/0.0)) : VALUE(new Double(1.0/0.0));
-        if(v->type() == typeid(Double) && v->dvalue() > MAXINT)    return VALUE(new Double(ceil(v->dvalue())));
-        if(v->type() == typeid(Double) && v->dvalue() < MININT)    return VALUE(new Double(ceil(v->dvalue())));
-        if(v->type() == typeid(Double))                            return VALUE(new Integer(ceil(v->dvalue())));
+                if(integer || test.len) more = test.inclusive ? i <= limit : i < limit;
+                else more = test.inclusive ? i <= dlimit : i < dlimit;
 
-        throw BasicRuntimeError("Unsupported argument to `CEIL()`: (" + v->name() + ")");
-    }
+                if(!more) break;
 
-    static VALUE builtin_eval(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor) {
-        VALUE v = any_cast<VALUE>(visitor->visit(vexpr[0]));
+                visitor->tick(vexpr[3]);
+                result = any_cast<VALUE>(visitor->visit(vexpr[3]));
 
-        if(v->type() == typeid(String)) {
-            return eval(v->svalue(), visitor->getSymbols());
+                /* Wraps as `i++` does */
+                i = static_cast<int64_t>(static_cast<uint64_t>(i) + 1);
+            }
         }
+        catch(...) {
+            symbols->set(test.counter, VALUE(new Integer(i)));
 
-        throw BasicRuntimeError("Unsupported argument to `EVAL()`: (" + v->name() + ")");
-    }
-
-    static VALUE builtin_floor(const vector<VALUE>& vv) {
-        VALUE v = vv[0];
+            throw;
+        }
 
-        if(v->type() == typeid(Integer))                           return VALUE(new Integer(floor(v->dvalue())));
-        if(v->type() == typeid(Double) && std::isnan(v->dvalue())) return VALUE(new Double(0.0/0.0));
-        if(v->type() == typeid(Double) && std::isinf(v->dvalue())) return v->dvalue() < 0 ? VALUE(new Double(-1.0/0.0)) : VALUE(new Double(1.0/0.0));
-        if(v->type() == typeid(Double) && v->dvalue() > MAXINT)    return VALUE(new Double(floor(v->dvalue())));
-        if(v->type() == typeid(Double) && v->dvalue() < MININT)    return VALUE(new Double(floor(v->dvalue())));
-        if(v->type() == typeid(Double))                            return VALUE(new Integer(floor(v->dvalue())));
+        symbols->set(test.counter, VALUE(new Integer(i)));
 
-        throw BasicRuntimeError("Unsupported argument to `FLOOR()`: (" + v->name() + ")");
+        return true;
     }
 
     static VALUE builtin_for(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor) {
         VALUE result(new Integer(0));
+        LoopTest test;
 
         visitor->visit(vexpr[0]);
 
+        /* FOR(i = a, i < b, i++, ...) runs with a native counter until the
+        * body changes the type of `i` or the test stops being numeric. */
+        if(loop_test(vexpr[1], visitor, test) && loop_step(vexpr[2]) == test.counter) {
+            SYMBOLS symbols = visitor->getSymbols();
+            int status;
+
+            if(local_loop(vexpr, visitor, test, result)) return result;
+
+            while((status = run_loop_test(test, symbols)) == 1) {
+                visitor->tick(vexpr[3]);
+                result = any_cast<VALUE>(visitor->visit(vexpr[3]));
+
+                VALUE counter = symbols->get(test.counter);
+
+                if(counter->type() == typeid(Integer)) {
+                    symbols->set(test.counter, counter->op_inc());
+                }
+                else {
+                    visitor->visit(vexpr[2]);
+                }
+            }
+
+            if(status == 0) return result;
+        }
+
         while(any_cast<VALUE>(visitor->visit(vexpr[1]))->istrue()) {
+            visitor->tick(vexpr[3]);
             result = any_cast<VALUE>(visitor->visit(vexpr[3]));
 
             visitor->visit(vexpr[2]);
@@ -1607,16 +6272,37 @@ namespace liteexpr {
 
         if(iterable->type() == typeid(Array)) {
             for(auto v: iterable->avalue()) {
+                visitor->tick(vexpr[2]);
                 ident->set(v);
                 result = any_cast<VALUE>(visitor->visit(vexpr[2]));
             }
         }
+        else if(iterable->type() == typeid(ArrayView)) {
+            ARRAYVIEW array = dynamic_pointer_cast<ArrayView>(resolved(iterable));
+
+            for(int64_t i = 0; i < array->length(); i++) {
+                visitor->tick(vexpr[2]);
+                ident->set(array->find(i));
+                result = any_cast<VALUE>(visitor->visit(vexpr[2]));
+            }
+        }
+        else if(iterable->type() == typeid(ObjectView)) {
+            for(auto v: dynamic_pointer_cast<ObjectView>(resolved(iterable))->members()) {
+                VALUE name(new String(v.first));
+                vector<VALUE> pair = { name, v.second };
+
+                visitor->tick(vexpr[2]);
+                ident->set(VALUE(new Array(pair)));
+                result = any_cast<VALUE>(visitor->visit(vexpr[2]));
+            }
+        }
         else if(iterable->type() == typeid(Object) || iterable->type() == typeid(SymbolTable)) {
             for(auto v: iterable->ovalue()) {
                 VALUE name(new String(v.first));
                 VALUE value(v.second);
                 vector<VALUE> pair = { name, value };
 
+                visitor->tick(vexpr[2]);
                 ident->set(VALUE(new Array(pair)));
                 result = any_cast<VALUE>(visitor->visit(vexpr[2]));
             }
@@ -1626,6 +6312,126 @@ namespace liteexpr {
         return result;
     }
 
+    static VALUE builtin_closure(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor, SYMBOLS upscope) {
+        LiteExprParser::ExprContext* body = vexpr[0];
+        bool tail = visitor->isTailCall();
+        vector<VALUE> args;
+
+        args.reserve(vexpr.size()-1);
+
+        for(auto expr=vexpr.begin()+1; expr!=vexpr.end(); expr++) {
+            /* An Ident keeps its container alive after the caller's frame is gone */
+            args.push_back(any_cast<VALUE>(visitor->visit(*expr)));
+        }
+
+        if(tail) return VALUE(new TailCall(upscope, body, std::move(args)));
+
+        return run_closure(visitor, upscope, body, std::move(args));
+    }
+
+    /*
+    * Collect the names a closure body refers to.  Returns false if the body
+    * needs its whole defining scope.
+    */
+    static bool free_names(antlr4::tree::ParseTree* node, std::set<string>& names) {
+        if(auto var = dynamic_cast<LiteExprParser::SimpleVarContext*>(node)) {
+            string name = var->ID()->getText();
+
+            if(name == "UPSCOPE" || name == "EVAL") return false;
+            if(name != "ARG" && name != "GLOBAL") names.insert(name);
+
+            return true;
+        }
+
+        /* Member names are keys, not variables */
+        if(auto var = dynamic_cast<LiteExprParser::MemberVarContext*>(node)) {
+            return free_names(var->varname(0), names);
+        }
+
+        for(auto child : node->children) {
+            if(!free_names(child, names)) return false;
+        }
+
+        return true;
+    }
+
+    /*
+    * The scope a new closure keeps.  Closures defined at the global scope
+    * keep it as is; nested closures keep only the variables they use.
+    */
+    static SYMBOLS capture(SYMBOLS scope, LiteExprParser::ExprContext* body) {
+        std::set<string> names;
+
+        if(!scope->has("UPSCOPE")) return scope;
+        if(!free_names(body, names)) return scope;
+
+        return SYMBOLS(new Captures(scope, names));
+    }
+
+    Memo::Memo(FUNCTION memoized, int64_t capacity) {
+        this->memoized = memoized;
+        this->results.reset(new ResultCache({}, {}, capacity, std::chrono::milliseconds(0)));
+    }
+
+    /* Arguments are passed by value, so a memoized closure can't assign to
+    * its caller's variables through ARG */
+    VALUE Memo::call(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor) {
+        vector<const Value*> containers;
+        vector<VALUE> args;
+        string key;
+
+        args.reserve(vexpr.size());
+
+        for(LiteExprParser::ExprContext* expr : vexpr) {
+            VALUE arg = resolved(any_cast<VALUE>(visitor->visit(expr)));
+
+            ResultCache::fingerprint(key, arg, containers);
+            args.push_back(arg);
+        }
+
+        VALUE result = this->results->find(key);
+
+        if(result) return result;
+
+        if(this->memoized->isClosure()) {
+            result = run_closure(visitor, this->memoized->scope, this->memoized->staticExpr, std::move(args));
+        }
+        else {
+            result = this->memoized->func(args);
+        }
+
+        this->results->insert(key, result);
+
+        return result;
+    }
+
+    static const int64_t MEMO_CAPACITY = 1024;
+
+    /*
+    * A function that remembers what a closure, or a host function that takes
+    * values, returned for each list of arguments, up to a number of them.
+    * Nothing else is compared, so what the function reads from its scope and
+    * what it does besides returning are only seen the first time.
+    */
+    static VALUE builtin_memo(const vector<VALUE>& vv) {
+        FUNCTION memoized = dynamic_pointer_cast<Function>(resolved(vv[0]));
+        int64_t capacity = MEMO_CAPACITY;
+
+        if(!memoized || (memoized->isDeferred() && !memoized->isClosure())) {
+            throw BasicRuntimeError(ErrorCode::UNSUPPORTED_ARGUMENT, "MEMO()", vv[0]->name());
+        }
+
+        if(vv.size() > 1) {
+            if(vv[1]->type() != typeid(Integer) || vv[1]->ivalue() < 1) {
+                throw BasicRuntimeError(ErrorCode::UNSUPPORTED_ARGUMENT, "MEMO()", vv[1]->name());
+            }
+
+            capacity = vv[1]->ivalue();
+        }
+
+        return VALUE(new Function(memoized, capacity));
+    }
+
     static VALUE builtin_function(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor) {
         STRING argfmt = dynamic_pointer_cast<String>(any_cast<VALUE>(visitor->visit(vexpr[0])));
         LiteExprParser::ExprContext* parseTree = vexpr[1];
@@ -1646,21 +6452,7 @@ namespace liteexpr {
             if(maxargs < minargs) maxargs = minargs;
         }
 
-        Function* func = new Function(
-            [](vector<LiteExprParser::ExprContext*>& ivexpr, Evaluator* ivisitor, SYMBOLS upscope) {
-                SYMBOLS scope = SYMBOLS(new SymbolTable(upscope));
-                Evaluator evaluator(scope);
-                ARRAY args(new Array());
-
-                for(auto expr=ivexpr.begin()+1; expr!=ivexpr.end(); expr++) {
-                    args->push(any_cast<VALUE>(ivisitor->visit(*expr)));
-                }
-
-                scope->set("ARG", args);
-
-                return any_cast<VALUE>(evaluator.visit(ivexpr[0]));
-            }, visitor->getSymbols(), minargs, maxargs
-        );
+        Function* func = new Function(builtin_closure, capture(visitor->getSymbols(), parseTree), minargs, maxargs);
 
         func->setStaticExpr(vexpr[1]);
 
@@ -1668,20 +6460,21 @@ namespace liteexpr {
     }
 
     static VALUE builtin_if(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor) {
+        bool tail = visitor->isTailCall();
         VALUE result(new Integer(0));
         int i = 0;
 
         /* IF + ELIF */
         for(i=0; i+1<vexpr.size(); i+=2) {
             if(any_cast<VALUE>(visitor->visit(vexpr[i]))->istrue()) {
-                result = any_cast<VALUE>(visitor->visit(vexpr[i+1]));
+                result = any_cast<VALUE>(tail ? visitor->visitTail(vexpr[i+1]) : visitor->visit(vexpr[i+1]));
                 break;
             }
         }
 
         /* ELSE */
         if(i == vexpr.size()-1) {
-            result = any_cast<VALUE>(visitor->visit(vexpr[i]));
+            result = any_cast<VALUE>(tail ? visitor->visitTail(vexpr[i]) : visitor->visit(vexpr[i]));
         }
 
         return result;
@@ -1691,8 +6484,8 @@ namespace liteexpr {
         try {
             return VALUE(new Integer(vv[0]->length()));
         }
-        catch(BasicRuntimeError e) {
-            throw BasicRuntimeError("Unsupported argument to `LEN()`: (" + vv[0]->name() + ")");
+        catch(const BasicRuntimeError& e) {
+            throw BasicRuntimeError(ErrorCode::UNSUPPORTED_ARGUMENT, "LEN()", vv[0]->name());
         }
     }
 
@@ -1719,7 +6512,7 @@ namespace liteexpr {
         if(v->type() == typeid(Double) && v->dvalue() < MININT)    return VALUE(new Double(round(v->dvalue())));
         if(v->type() == typeid(Double))                            return VALUE(new Integer(round(v->dvalue())));
 
-        throw BasicRuntimeError("Unsupported argument to `ROUND()`: (" + v->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_ARGUMENT, "ROUND()", v->name());
     }
 
     static VALUE builtin_sqrt(const vector<VALUE>& vv) {
@@ -1731,13 +6524,22 @@ namespace liteexpr {
             return VALUE(new Double(sqrt(d)));
         }
 
-        throw BasicRuntimeError("Unsupported argument to `SQRT()`: (" + v->name() + ")");
+        throw BasicRuntimeError(ErrorCode::UNSUPPORTED_ARGUMENT, "SQRT()", v->name());
     }
 
     static VALUE builtin_while(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor) {
         VALUE result(new Integer(0));
+        SYMBOLS symbols = visitor->getSymbols();
+        LoopTest test;
+        bool counted = loop_test(vexpr[0], visitor, test);
 
-        while(any_cast<VALUE>(visitor->visit(vexpr[0]))->istrue()) {
+        while(true) {
+            int status = counted ? run_loop_test(test, symbols) : -1;
+
+            if(status < 0) status = any_cast<VALUE>(visitor->visit(vexpr[0]))->istrue();
+            if(!status) break;
+
+            visitor->tick(vexpr[1]);
             result = any_cast<VALUE>(visitor->visit(vexpr[1]));
         }
 
@@ -1753,11 +6555,299 @@ namespace liteexpr {
         { "FUNCTION" , VALUE(new Function(builtin_function , 2,       2)) },
         { "IF"       , VALUE(new Function(builtin_if       , 2, MAXARGS)) },
         { "LEN"      , VALUE(new Function(builtin_len      , 1         )) },
+        { "MEMO"     , VALUE(new Function(builtin_memo     , 1,       2)) },
         { "PRINT"    , VALUE(new Function(builtin_print                )) },
         { "ROUND"    , VALUE(new Function(builtin_round    , 1         )) },
         { "SQRT"     , VALUE(new Function(builtin_sqrt     , 1         )) },
         { "WHILE"    , VALUE(new Function(builtin_while    , 2,       2)) },
     };
+
+    /* The builtins as initialized, even if the host later replaces them */
+    static const map<string,VALUE> natives = builtins;
+
+    static bool is_builtin(VALUE value, const string& name) {
+        auto found = natives.find(name);
+
+        return found != natives.end() && value == found->second;
+    }
+}
+
+
+/* ***************************************************************************
+* COLLECTOR
+*/
+
+namespace liteexpr {
+    /*
+    * The live collectables made by one thread, newest first.  Only its thread
+    * adds to it, so its lock is contended only when a value is freed by
+    * another thread, or by collect().  collect() resumes from cursor.
+    * Registries are never freed: when a thread exits, the next new thread
+    * adopts its registry along with any values still in it.
+    */
+    struct Registry {
+        std::mutex lock;
+        Collectable* head = nullptr;
+        Collectable* cursor = nullptr;
+        bool orphaned = false;
+        Registry* next = nullptr;
+    };
+
+    /*
+    * Every registry, and the one collect() sweeps next.  Plain pointers, so
+    * they are set before any value is made during static initialization.
+    */
+    static std::mutex registries_lock;
+    static Registry* registries = nullptr;
+    static Registry* turn = nullptr;
+
+    /* The calling thread's registry */
+    static Registry* local_registry() {
+        static thread_local struct Local {
+            Registry* registry = nullptr;
+
+            Local() {
+                std::lock_guard<std::mutex> guard(registries_lock);
+
+                for(Registry* r = registries; r; r = r->next) {
+                    if(r->orphaned) {
+                        r->orphaned = false;
+                        this->registry = r;
+                        return;
+                    }
+                }
+
+                this->registry = new Registry();
+                this->registry->next = registries;
+                registries = this->registry;
+            }
+
+            ~Local() {
+                std::lock_guard<std::mutex> guard(registries_lock);
+
+                this->registry->orphaned = true;
+            }
+        } local;
+
+        return local.registry;
+    }
+
+    Collectable::Collectable() {
+        this->registry = local_registry();
+
+        std::lock_guard<std::mutex> guard(this->registry->lock);
+
+        this->prev = nullptr;
+        this->next = this->registry->head;
+
+        if(this->next) this->next->prev = this;
+        this->registry->head = this;
+    }
+
+    Collectable::Collectable(const Collectable&): Collectable() {
+    }
+
+    Collectable& Collectable::operator=(const Collectable&) {
+        return *this;
+    }
+
+    Collectable::~Collectable() {
+        std::lock_guard<std::mutex> guard(this->registry->lock);
+
+        if(this->registry->cursor == this) this->registry->cursor = this->next;
+        if(this->prev) this->prev->next = this->next;
+        else this->registry->head = this->next;
+        if(this->next) this->next->prev = this->prev;
+    }
+
+    /* Approximate heap bytes held by a value itself, not counting values it refers to */
+    static size_t footprint(const Value* value) {
+        const type_info& type = typeid(*value);
+
+        if(type == typeid(String)) return sizeof(String) + static_cast<const String*>(value)->native().capacity();
+        if(type == typeid(Array)) return sizeof(Array) + static_cast<const Array*>(value)->native().capacity() * sizeof(VALUE);
+        if(type == typeid(Integer)) return sizeof(Integer);
+        if(type == typeid(Double)) return sizeof(Double);
+        if(type == typeid(Function)) return sizeof(Function);
+        if(type == typeid(Ident)) return sizeof(Ident);
+
+        if(const Object* object = dynamic_cast<const Object*>(value)) {
+            size_t bytes = (type == typeid(Object)) ? sizeof(Object) : (type == typeid(Captures)) ? sizeof(Captures) : sizeof(SymbolTable);
+
+            for(const auto& kv : object->native()) {
+                bytes += sizeof(kv) + 4 * sizeof(void*) + (kv.first.capacity() > 15 ? kv.first.capacity() + 1 : 0);
+            }
+
+            return bytes;
+        }
+
+        return sizeof(Value);
+    }
+
+    /* Whether a collectable refers to any other, and so could be in a cycle */
+    static bool refers(const Collectable* c) {
+        vector<Value*> refs;
+
+        c->traverse(refs);
+
+        for(Value* ref : refs) {
+            if(dynamic_cast<Collectable*>(ref)) return true;
+        }
+
+        return false;
+    }
+
+    static size_t strong_count(const Collectable* c) {
+        return c->weak_from_this().use_count();
+    }
+
+    /*
+    * Free reference cycles that nothing outside the cycle refers to, by trial
+    * deletion: within a set of collectables, subtract the references each
+    * receives from the others; whatever is left with no references, and is
+    * not reachable from a member that has some, is garbage.
+    *
+    * With a budget, only that many collectables are examined: those reachable
+    * from the next registered one onward, so successive calls sweep the heap
+    * in bounded steps.  Cycles larger than the budget need collect(0), which
+    * examines everything.  Do not call while any thread is evaluating or
+    * otherwise using values.
+    */
+    Collected collect(size_t budget) {
+        Collected result = { 0, 0, 0 };
+        vector<Collectable*> members;
+        std::unordered_map<Collectable*,size_t> index;
+        vector<shared_ptr<Collectable> > garbage;
+        std::unordered_set<Value*> leaves;
+        vector<Value*> refs;
+
+        {
+            std::lock_guard<std::mutex> guard(registries_lock);
+            vector<std::unique_lock<std::mutex> > locks;
+
+            for(Registry* r = registries; r; r = r->next) locks.emplace_back(r->lock);
+
+            /* Choose the members */
+            if(budget == 0) {
+                for(Registry* r = registries; r; r = r->next) {
+                    for(Collectable* c = r->head; c; c = c->next) {
+                        index.emplace(c, members.size());
+                        members.push_back(c);
+                    }
+                }
+            }
+            else if(registries) {
+                if(!turn) turn = registries;
+
+                /* Sweep the registries in turn, each from its cursor onward */
+                for(size_t visited = 0; visited <= locks.size() && members.size() < budget; ) {
+                    Collectable*& cursor = turn->cursor;
+
+                    if(!cursor) {
+                        turn = turn->next ? turn->next : registries;
+                        turn->cursor = turn->head;
+                        visited++;
+                        continue;
+                    }
+
+                    size_t start = members.size();
+
+                    if(!index.count(cursor)) {
+                        index.emplace(cursor, members.size());
+                        members.push_back(cursor);
+                    }
+
+                    /* Follow references breadth-first from each start */
+                    for(size_t j = start; j < members.size() && members.size() < budget; j++) {
+                        refs.clear();
+                        members[j]->traverse(refs);
+
+                        for(Value* ref : refs) {
+                            Collectable* c = dynamic_cast<Collectable*>(ref);
+
+                            if(c && !index.count(c) && members.size() < budget && refers(c)) {
+                                index.emplace(c, members.size());
+                                members.push_back(c);
+                            }
+                        }
+                    }
+
+                    cursor = cursor->next;
+                }
+            }
+
+            /* Count the references from outside the members */
+            vector<int64_t> external(members.size());
+
+            for(size_t i = 0; i < members.size(); i++) {
+                size_t count = strong_count(members[i]);
+
+                /* Not owned by a shared_ptr, so owned by the host */
+                external[i] = count ? count : 1;
+            }
+
+            for(Collectable* c : members) {
+                refs.clear();
+                c->traverse(refs);
+
+                for(Value* ref : refs) {
+                    auto found = index.find(dynamic_cast<Collectable*>(ref));
+                    if(found != index.end()) external[found->second]--;
+                }
+            }
+
+            /* Keep whatever is reachable from outside */
+            vector<bool> live(members.size());
+            vector<size_t> pending;
+
+            for(size_t i = 0; i < members.size(); i++) {
+                if(external[i] > 0) {
+                    live[i] = true;
+                    pending.push_back(i);
+                }
+            }
+
+            while(!pending.empty()) {
+                size_t i = pending.back();
+
+                pending.pop_back();
+                refs.clear();
+                members[i]->traverse(refs);
+
+                for(Value* ref : refs) {
+                    auto found = index.find(dynamic_cast<Collectable*>(ref));
+
+                    if(found != index.end() && !live[found->second]) {
+                        live[found->second] = true;
+                        pending.push_back(found->second);
+                    }
+                }
+            }
+
+            /* Hold the garbage so clearing one member cannot free another midway */
+            for(size_t i = 0; i < members.size(); i++) {
+                if(live[i]) continue;
+
+                refs.clear();
+                members[i]->traverse(refs);
+
+                result.bytes += footprint(dynamic_cast<Value*>(members[i]));
+
+                for(Value* ref : refs) {
+                    if(ref && !dynamic_cast<Collectable*>(ref) && leaves.insert(ref).second) result.bytes += footprint(ref);
+                }
+
+                garbage.push_back(members[i]->shared_from_this());
+            }
+
+            result.examined = members.size();
+            result.objects = garbage.size();
+        }
+
+        for(auto& c : garbage) c->clear();
+
+        return result;
+    }
 }
 
 
@@ -1806,6 +6896,32 @@ namespace liteexpr {
         return ARRAY(new Array(vv));
     }
 
+    TYPEDARRAY make_typed_array(const int64_t* data, size_t size, shared_ptr<const void> owner) {
+        return TYPEDARRAY(new TypedArray(data, size, owner));
+    }
+
+    TYPEDARRAY make_typed_array(const double* data, size_t size, shared_ptr<const void> owner) {
+        return TYPEDARRAY(new TypedArray(data, size, owner));
+    }
+
+    /* A file of native-endian 64-bit numbers as an array.  The file is mapped,
+    * so its pages are read as they are used and shared between processes. */
+    TYPEDARRAY map_typed_array(const string& path, ElementType element) {
+        shared_ptr<MappedFile> file = std::make_shared<MappedFile>(path, "array file");
+
+        if(file->size % 8) throw BasicRuntimeError("Invalid array file: " + path);
+
+        if(element == ElementType::DOUBLE) {
+            return make_typed_array(reinterpret_cast<const double*>(file->data), file->size / 8, file);
+        }
+
+        return make_typed_array(reinterpret_cast<const int64_t*>(file->data), file->size / 8, file);
+    }
+
+    ARRAYVIEW make_array_view(const vector<string>& data, shared_ptr<const void> owner) {
+        return ARRAYVIEW(new StringArrayView(data, owner));
+    }
+
     OBJECT make_object(initializer_list<pair<string,VALUE> > vv) {
         return OBJECT(new Object(vv));
     }
@@ -3,12 +3,21 @@
 
 #include <any>
 #include <map>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <set>
+#include <functional>
+#include <unordered_map>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <memory>
 #include <utility>
 #include <cstdint>
+#include <cstddef>
 #include <codecvt>
+#include <ostream>
 #include <iostream>
 #include <initializer_list>
 #include "antlr4-runtime.h"
@@ -36,8 +45,12 @@ namespace liteexpr {
     class Double;
     class String;
     class Array;
+    class ArrayView;
+    class TypedArray;
     class Object;
+    class ObjectView;
     class SymbolTable;
+    class Captures;
     class Ident;
     class Function;
     class Evaluator;
@@ -46,16 +59,87 @@ namespace liteexpr {
     typedef shared_ptr<Double> DOUBLE;
     typedef shared_ptr<String> STRING;
     typedef shared_ptr<Array> ARRAY;
+    typedef shared_ptr<ArrayView> ARRAYVIEW;
+    typedef shared_ptr<TypedArray> TYPEDARRAY;
     typedef shared_ptr<Object> OBJECT;
+    typedef shared_ptr<ObjectView> OBJECTVIEW;
     typedef shared_ptr<SymbolTable> SYMBOLS;
     typedef shared_ptr<Ident> IDENT;
     typedef shared_ptr<Function> FUNCTION;
     extern int64_t MAXARGS;
 
+    /*
+    * A value that holds references to other values, and so may be part of a
+    * reference cycle.  Live collectables are registered so collect() can
+    * find cycles that are no longer referenced from outside.  Each thread
+    * registers into its own list, so threads don't contend to create values.
+    */
+    struct Registry;
+
+    class Collectable: public std::enable_shared_from_this<Collectable> {
+        Collectable* prev;
+        Collectable* next;
+        Registry* registry;
+
+        friend struct Collected collect(size_t budget);
+
+        public:
+            Collectable();
+            Collectable(const Collectable&);
+            Collectable& operator=(const Collectable&);
+            virtual ~Collectable();
+
+            virtual void traverse(vector<Value*>& refs) const=0;
+            virtual void clear()=0;
+    };
+
+    enum class Format { PRETTY, COMPACT };
+
+    /*
+    * Where values are written by write().  Pretty output is what encoded()
+    * returns; compact output is the same on a single line.  Output goes to a
+    * string, or to a stream in chunks.
+    */
+    class Writer {
+        std::ostream* out;
+        string* buffer;
+        string chunk;
+        bool pretty;
+        int depth;
+
+        public:
+            Writer(std::ostream& out, Format format=Format::PRETTY);
+            Writer(string& buffer, Format format=Format::PRETTY);
+            Writer(const Writer&) = delete;
+            ~Writer();
+
+            bool isPretty() const;
+            void put(char c);
+            void put(const char* text, size_t size);
+            void put(const string& text);
+            void indent();
+            void dedent();
+            void newline();
+            void flush();
+    };
+
+    /*
+    * Bytes of storage a value owns that were charged to an evaluation's
+    * memory limit, and the evaluation they were charged to.
+    */
+    struct Charge {
+        uint64_t meter = 0;
+        int64_t bytes = 0;
+    };
+
     class Value {
         public:
+            static void* operator new(size_t size);
+            static void operator delete(void* p, size_t size);
+
             virtual string name() const=0;
             virtual string encoded() const=0;
+            virtual void write(Writer& out) const;
             virtual const type_info& type() const=0;
 
             virtual bool istrue() const;
@@ -103,6 +187,7 @@ namespace liteexpr {
 
             string name() const override;
             string encoded() const override;
+            void write(Writer& out) const override;
             const type_info& type() const override;
 
             bool istrue() const override;
@@ -145,6 +230,7 @@ namespace liteexpr {
 
             string name() const override;
             string encoded() const override;
+            void write(Writer& out) const override;
             const type_info& type() const override;
 
             bool istrue() const override;
@@ -168,16 +254,20 @@ namespace liteexpr {
 
     class String: public Value {
         string value;
+        Charge charged;
 
         public:
             String(const string& v);
+            ~String();
             const string& native() const;
             static string encode(const string& decoded);
+            static void encode(Writer& out, const string& decoded);
             static string decode(const string& encoded);
             static vector<string> split(const string& text, const string& delim);
 
             string name() const override;
             string encoded() const override;
+            void write(Writer& out) const override;
             const type_info& type() const override;
 
             bool istrue() const override;
@@ -192,20 +282,28 @@ namespace liteexpr {
             VALUE op_add(const VALUE other) const override;
     };
 
-    class Array: public Value {
+    class Array: public Value, public Collectable {
         vector<VALUE> value;
+        Charge charged;
+
+        void account();
 
         public:
             Array();
             Array(const vector<VALUE>& v);
+            Array(vector<VALUE>&& v);
+            ~Array();
             const vector<VALUE>& native() const;
             static string encode(const vector<VALUE>& decoded);
+            static void encode(Writer& out, const vector<VALUE>& decoded);
+            VALUE find(int64_t i) const;
             VALUE get(int64_t i) const;
             void set(int64_t i, VALUE v);
             void push(VALUE v);
 
             string name() const override;
             string encoded() const override;
+            void write(Writer& out) const override;
             const type_info& type() const override;
 
             bool istrue() const override;
@@ -219,24 +317,35 @@ namespace liteexpr {
             VALUE op_lte(const VALUE other) const override;
             VALUE op_gte(const VALUE other) const override;
             VALUE op_add(const VALUE other) const override;
+
+            void traverse(vector<Value*>& refs) const override;
+            void clear() override;
     };
 
-    class Object: public Value {
+    class Object: public Value, public Collectable {
         protected:
             map<string,VALUE> value;
+            int64_t accounted;
+            Charge charged;
             Object();
+            void account();
 
         public:
             Object(initializer_list<pair<string,VALUE> > init);
             Object(const map<string,VALUE>& v);
+            Object(map<string,VALUE>&& v);
+            ~Object();
             const map<string,VALUE>& native() const;
             static string encode(const map<string,VALUE>& decoded, SYMBOLS parent=nullptr);
-            virtual VALUE get(const string& k);
+            static void encode(Writer& out, const map<string,VALUE>& decoded, SYMBOLS parent=nullptr);
+            virtual VALUE find(const string& k);
+            VALUE get(const string& k);
             virtual void set(const string& k, VALUE v);
             virtual bool has(const string& k);
 
             virtual string name() const override;
             virtual string encoded() const override;
+            virtual void write(Writer& out) const override;
             virtual const type_info& type() const override;
 
             virtual bool istrue() const override;
@@ -245,23 +354,75 @@ namespace liteexpr {
             virtual string svalue() const override;
             virtual VALUE op_eq(const VALUE other) const override;
             virtual VALUE op_ne(const VALUE other) const override;
+
+            virtual void traverse(vector<Value*>& refs) const override;
+            virtual void clear() override;
     };
 
+    /*
+    * Loads the value of a symbol on demand, or returns nullptr if there is
+    * no such symbol.
+    */
+    typedef std::function<VALUE(const string& k)> Resolver;
+
+    /*
+    * Told the name of each symbol set in a table.
+    */
+    typedef std::function<void(const string& k)> Observer;
+
     class SymbolTable: public Object {
+        friend class Captures;
+
         SYMBOLS parent;
         SYMBOLS root;
+        mutable bool linked;
+        Resolver resolver;
+        std::set<string> unresolved;
+        Observer observer;
+
+        void link() const;
+        VALUE resolve(const string& k);
 
         public:
             SymbolTable(initializer_list<pair<string,VALUE> > init);
             SymbolTable(SYMBOLS parent=nullptr);
-            VALUE get(const string& k) override;
+            void setResolver(Resolver resolver);
+            void setObserver(Observer observer);
+            VALUE find(const string& k) override;
             void set(const string& k, VALUE v) override;
             bool has(const string& k) override;
+            void define(const string& k, VALUE v);
 
             string encoded() const override;
+            void write(Writer& out) const override;
+            bool istrue() const override;
+            int64_t length() const override;
+            const map<string,VALUE>& ovalue() const override;
+
+            void traverse(vector<Value*>& refs) const override;
+            void clear() override;
+    };
+
+    class Captures: public SymbolTable {
+        map<string,SYMBOLS> cells;
+
+        public:
+            Captures(SYMBOLS scope, const std::set<string>& names);
+            ~Captures();
+            VALUE find(const string& k) override;
+            void set(const string& k, VALUE v) override;
+            bool has(const string& k) override;
+            const type_info& type() const override;
+
+            void traverse(vector<Value*>& refs) const override;
+            void clear() override;
     };
 
-    class Function: public Value {
+    class Memo;
+
+    class Function: public Value, public Collectable {
+        friend class Memo;
+
         VALUE (*func)(const vector<VALUE>&);
         VALUE (*dfunc)(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor);
         VALUE (*xfunc)(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor, SYMBOLS scope);
@@ -269,20 +430,184 @@ namespace liteexpr {
         int64_t minargs;
         int64_t maxargs;
         SYMBOLS scope;
+        shared_ptr<Memo> memo;
+        bool pure;
 
         public:
             Function(VALUE (*func)(const vector<VALUE>& vv), int64_t minargs=0, int64_t maxargs=MAXARGS);
             Function(VALUE (*func)(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor), int64_t minargs=0, int64_t maxargs=MAXARGS);
             Function(VALUE (*func)(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor, SYMBOLS scope), SYMBOLS scope, int64_t minargs=0, int64_t maxargs=MAXARGS);
+            Function(FUNCTION memoized, int64_t capacity);
 
             VALUE call(vector<LiteExprParser::ExprContext*>& vexpr, Evaluator* visitor) const;
+            void checkArgs(int64_t count) const;
+            bool isDeferred() const;
+            bool isClosure() const;
+            bool isPure() const;
             SYMBOLS getScope() const;
+            LiteExprParser::ExprContext* getStaticExpr() const;
 
             string name() const override;
             string encoded() const override;
             const type_info& type() const override;
 
             void setStaticExpr(LiteExprParser::ExprContext*);
+            void setPure(bool pure);
+
+            void traverse(vector<Value*>& refs) const override;
+            void clear() override;
+    };
+}
+
+
+/* ***************************************************************************
+* VIEWS
+*/
+
+namespace liteexpr {
+    /*
+    * An array that reads host data in place, boxing each element as it is
+    * read.  A view is read-only unless it is made copy-on-write, in which
+    * case the first assignment into it copies it to an ordinary array that
+    * the view uses from then on.  The host data is never written.
+    */
+    class ArrayView: public Value {
+        ARRAY copy;
+        bool copyOnWrite;
+
+        protected:
+            ArrayView();
+            bool copied() const;
+            virtual int64_t size() const=0;
+            virtual VALUE element(int64_t i) const=0;
+
+        public:
+            void setCopyOnWrite(bool enabled);
+            VALUE find(int64_t i) const;
+            VALUE get(int64_t i) const;
+            void set(int64_t i, VALUE v);
+
+            string name() const override;
+            string encoded() const override;
+            void write(Writer& out) const override;
+            const type_info& type() const override;
+
+            bool istrue() const override;
+            int64_t length() const override;
+            string svalue() const override;
+            VALUE op_eq(const VALUE other) const override;
+            VALUE op_ne(const VALUE other) const override;
+    };
+
+    /*
+    * An object that reads host data in place, as ArrayView does for arrays.
+    */
+    class ObjectView: public Value {
+        OBJECT copy;
+        bool copyOnWrite;
+
+        protected:
+            ObjectView();
+            virtual vector<string> keys() const=0;
+            virtual VALUE member(const string& k) const=0;
+
+        public:
+            void setCopyOnWrite(bool enabled);
+            map<string,VALUE> members() const;
+            VALUE find(const string& k) const;
+            VALUE get(const string& k) const;
+            void set(const string& k, VALUE v);
+
+            string name() const override;
+            string encoded() const override;
+            void write(Writer& out) const override;
+            const type_info& type() const override;
+
+            bool istrue() const override;
+            int64_t length() const override;
+            string svalue() const override;
+            VALUE op_eq(const VALUE other) const override;
+            VALUE op_ne(const VALUE other) const override;
+    };
+
+    enum class ElementType { INT64, DOUBLE };
+
+    /*
+    * Numbers stored unboxed in memory the array does not own, such as a
+    * mapped file or a host buffer.  The owner, if any, is kept alive for as
+    * long as the array.
+    */
+    class TypedArray: public ArrayView {
+        shared_ptr<const void> owner;
+        const void* data;
+        int64_t count;
+        ElementType elementType;
+
+        protected:
+            int64_t size() const override;
+            VALUE element(int64_t i) const override;
+
+        public:
+            TypedArray(const int64_t* data, int64_t size, shared_ptr<const void> owner=nullptr);
+            TypedArray(const double* data, int64_t size, shared_ptr<const void> owner=nullptr);
+            ElementType getElementType() const;
+            const void* native() const;
+
+            void write(Writer& out) const override;
+    };
+
+    class StringArrayView: public ArrayView {
+        shared_ptr<const void> owner;
+        const vector<string>* data;
+
+        protected:
+            int64_t size() const override;
+            VALUE element(int64_t i) const override;
+
+        public:
+            StringArrayView(const vector<string>& data, shared_ptr<const void> owner=nullptr);
+    };
+
+    /*
+    * How a member of a host struct is read.
+    */
+    template<typename T> struct Field {
+        string name;
+        std::function<VALUE(const T&)> get;
+    };
+
+    /*
+    * A host struct, whose members are described by a table of fields.  The
+    * table must outlive the view.
+    */
+    template<typename T> class StructView: public ObjectView {
+        shared_ptr<const void> owner;
+        const T* data;
+        const vector<Field<T> >* fields;
+
+        protected:
+            vector<string> keys() const override {
+                vector<string> keys;
+
+                for(const Field<T>& field : *this->fields) keys.push_back(field.name);
+
+                return keys;
+            }
+
+            VALUE member(const string& k) const override {
+                for(const Field<T>& field : *this->fields) {
+                    if(field.name == k) return field.get(*this->data);
+                }
+
+                return nullptr;
+            }
+
+        public:
+            StructView(const T& data, const vector<Field<T> >& fields, shared_ptr<const void> owner=nullptr) {
+                this->owner = owner;
+                this->data = &data;
+                this->fields = &fields;
+            }
     };
 }
 
@@ -292,7 +617,7 @@ namespace liteexpr {
 */
 
 namespace liteexpr {
-    class Ident: public Value {
+    class Ident: public Value, public Collectable {
         VALUE container;
         VALUE key;
 
@@ -300,11 +625,13 @@ namespace liteexpr {
             Ident(VALUE container, VALUE key);
             virtual ~Ident();
             void set(VALUE other);
+            VALUE find() const;
             VALUE get() const;
             VALUE getkey() const;
 
             string name() const override;
             string encoded() const override;
+            void write(Writer& out) const override;
             const type_info& type() const override;
 
             bool istrue() const override;
@@ -339,6 +666,9 @@ namespace liteexpr {
             VALUE op_and(const VALUE other) const override;
             VALUE op_xor(const VALUE other) const override;
             VALUE op_or(const VALUE other) const override;
+
+            void traverse(vector<Value*>& refs) const override;
+            void clear() override;
     };
 }
 
@@ -348,13 +678,98 @@ namespace liteexpr {
 */
 
 namespace liteexpr {
+    /*
+    * Stops an evaluation from another thread.  The evaluation notices at its
+    * next call or loop iteration and throws InterruptError.
+    */
+    class Cancellation {
+        std::atomic<bool> cancelled;
+
+        public:
+            Cancellation();
+            void cancel();
+            bool isCancelled() const;
+    };
+
+    /*
+    * Bytes of values allocated by an evaluation, net of those it freed, and
+    * the most that were held at once.
+    */
+    struct Usage {
+        int64_t current = 0;
+        int64_t peak = 0;
+    };
+
+    /*
+    * Bounds on a single evaluation.  Zero means no limit.  A step is a
+    * function call or a loop iteration; memory is in bytes.  If usage is
+    * set, it receives the evaluation's memory usage when it ends.
+    */
+    struct Limits {
+        int64_t steps = 0;
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(0);
+        shared_ptr<Cancellation> cancellation;
+        int64_t memory = 0;
+        Usage* usage = nullptr;
+    };
+
+    /*
+    * A stretch of source text, as offsets into it.
+    */
+    struct Span {
+        shared_ptr<const string> source;
+        size_t start = 0;
+        size_t stop = 0;
+    };
+
+    class Reordering;
+
     class Evaluator: public LiteExprBaseVisitor {
+        friend class Compiled;
+        friend class RuleSet;
+        friend class Reordering;
+
+        struct Shared;
+
         SYMBOLS symbols;
+        Evaluator* outer;
+        shared_ptr<const string> source;
+        Limits limits;
+        bool limited;
+        int64_t steps;
+        std::chrono::steady_clock::time_point deadline;
         map<LiteExprParser::ExprContext*,VALUE> cache;
+        LiteExprParser::ExprContext* tail;
+        bool tailcall;
+        map<LiteExprParser::ExprContext*,bool> inlinable;
+        const vector<VALUE>* args;
+        Shared* shared;
+        Reordering* reordering;
+        size_t visits;
+
+        VALUE inlineCall(FUNCTION fn, vector<LiteExprParser::ExprContext*>& vexpr);
+        void materialize();
+        Span span(antlr4::ParserRuleContext* ctx) const;
 
         public:
-            Evaluator(SYMBOLS s);
+            class Frame {
+                Evaluator* visitor;
+                SYMBOLS caller;
+                LiteExprParser::ExprContext* tail;
+                const vector<VALUE>* args;
+
+                public:
+                    Frame(Evaluator* visitor, SYMBOLS scope);
+                    ~Frame();
+            };
+
+            Evaluator(SYMBOLS s, const Limits& limits=Limits());
+            Evaluator(SYMBOLS s, Evaluator* outer);
             SYMBOLS getSymbols();
+            void tick(antlr4::ParserRuleContext* ctx);
+            bool isTailCall() const;
+            any visitTail(LiteExprParser::ExprContext* ctx);
+            any visit(antlr4::tree::ParseTree* tree) override;
 
             any visitFile(LiteExprParser::FileContext *ctx) override;
             any visitString(LiteExprParser::StringContext *ctx) override;
@@ -381,21 +796,97 @@ namespace liteexpr {
             any visitTerm(LiteExprParser::TermContext *ctx) override;
     };
 
+    /*
+    * What a program may touch, found without running it.  Paths are symbols
+    * with any member names after them, as in `order.price`; a computed key,
+    * as in `rates[code]`, ends the path since it may name any member.  The
+    * sets are unknown if the program uses EVAL, UPSCOPE or GLOBAL.
+    */
+    struct Dependencies {
+        std::set<string> reads;
+        std::set<string> writes;
+        std::set<string> calls;
+        bool unknown = false;
+    };
+
+    /*
+    * An operand of a chain of && or ||: how often it was evaluated, how often
+    * that decided the chain, and the parse nodes it visited in all.
+    */
+    struct Operand {
+        string source;
+        size_t evaluated = 0;
+        size_t decided = 0;
+        size_t cost = 0;
+    };
+
+    /*
+    * A chain of && or || and the order its operands are evaluated in.  It is
+    * fixed in its written order once an operand has failed out of order.
+    */
+    struct Chain {
+        string op;
+        vector<Operand> operands;
+        vector<size_t> order;
+        size_t evaluations = 0;
+        bool fixed = false;
+    };
+
+    /*
+    * How a compiled program's cached results have served it: results cached
+    * now, evaluations answered from the cache or not, and results dropped for
+    * room or for age.
+    */
+    struct Caching {
+        size_t entries = 0;
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evicted = 0;
+        size_t expired = 0;
+    };
+
+    class ResultCache;
+
     class Compiled {
+        shared_ptr<const string> source;
         antlr4::ANTLRInputStream* input;
         antlr4::CommonTokenStream* tokens;
         antlr4::ParserRuleContext* parseTree;
         LiteExprLexer* lexer;
         LiteExprParser* parser;
+        vector<std::unique_ptr<antlr4::Token> > loadedTokens;
+        vector<std::unique_ptr<antlr4::tree::ParseTree> > loadedNodes;
+        shared_ptr<Reordering> reordering;
+        shared_ptr<ResultCache> results;
+
+        struct Path { const string& path; };
+
+        Compiled(Path path);
+        void parse();
+
+        friend Compiled load_compiled(const string& path);
+        friend class RuleSet;
 
         public:
             Compiled(string);
             ~Compiled();
-            VALUE eval(SYMBOLS symbols);
+            VALUE eval(SYMBOLS symbols, const Limits& limits=Limits());
+            VALUE eval(Evaluator* caller);
+            void save(const string& path) const;
+            Dependencies dependencies() const;
+            void setReordering(bool enabled);
+            vector<Chain> getChains() const;
+            bool setCaching(size_t capacity, std::chrono::milliseconds ttl=std::chrono::milliseconds(0));
+            Caching getCaching() const;
+            Compiled specialize(SYMBOLS constants) const;
+            string getSource() const;
     };
 
     Compiled compile(const string& expr);
-    VALUE eval(const string& expr, SYMBOLS symbols);
+    Compiled compile(const string& expr, SYMBOLS constants);
+    Compiled load_compiled(const string& path);
+    VALUE eval(const string& expr, SYMBOLS symbols, const Limits& limits=Limits());
+    VALUE parse_value(std::string_view text);
 }
 
 
@@ -404,20 +895,65 @@ namespace liteexpr {
 */
 
 namespace liteexpr {
+    /*
+    * What went wrong.  The numbers are stable and may be relied on.
+    */
+    enum class ErrorCode: int {
+        GENERIC = 1,
+        SYNTAX = 2,
+        UNKNOWN_SYMBOL = 3,
+        UNSUPPORTED_OPERATION = 4,
+        UNSUPPORTED_OPERAND = 5,
+        UNSUPPORTED_OPERANDS = 6,
+        UNSUPPORTED_ARGUMENT = 7,
+        DIVISION_BY_ZERO = 8,
+        MODULUS_BY_ZERO = 9,
+        NEGATIVE_SHIFT = 10,
+        INDEX_OUT_OF_RANGE = 11,
+        ARGUMENT_COUNT = 12,
+        INTERRUPTED = 13,
+        OUT_OF_MEMORY = 14,
+    };
+
+    /*
+    * An error keeps what it is about -- its code, the operator, the operands'
+    * types or values, and where it happened -- and only puts its message
+    * together when asked for it.
+    */
     class Error {
+        ErrorCode code;
+        const char* op;
+        string operands[2];
         string text;
+        int line;
+        int col;
+        const char* context;
+        Span span;
 
         public:
             Error(const string& t);
             Error(const string& t, int line);
             Error(const string& t, int line, int col);
-            operator string() const { return this->text; }
+            Error(ErrorCode code, const string& t, int line=0, int col=-1);
+            Error(ErrorCode code, const char* op, const string& a="", const string& b="");
+            Error(const Error& e, int line, int col, const char* context=nullptr, const Span& span=Span());
+
+            ErrorCode getCode() const;
+            const char* getOperator() const;
+            const string& getOperand(size_t i) const;
+            int getLine() const;
+            int getColumn() const;
+            const Span& getSpan() const;
+            string message() const;
+            operator string() const;
     };
 
     class SyntaxError: public Error {
         public:
-            SyntaxError(const string& t, int line): Error(t, line) {};
-            SyntaxError(const string& t, int line, int col): Error(t, line, col) {};
+            SyntaxError(const string& t, int line): Error(ErrorCode::SYNTAX, t, line) {};
+            SyntaxError(const string& t, int line, int col): Error(ErrorCode::SYNTAX, t, line, col) {};
+            SyntaxError(const Error& e, int line, int col): Error(e, line, col) {};
+            SyntaxError(const Error& e, int line, int col, const Span& span): Error(e, line, col, "Syntax", span) {};
     };
 
     class RuntimeError: public Error {
@@ -425,16 +961,31 @@ namespace liteexpr {
             RuntimeError(const string& t): Error(t) {};
             RuntimeError(const string& t, int line): Error(t, line) {};
             RuntimeError(const string& t, int line, int col): Error(t, line, col) {};
+            RuntimeError(ErrorCode code, const string& t, int line=0, int col=-1): Error(code, t, line, col) {};
+            RuntimeError(const Error& e, int line, int col): Error(e, line, col) {};
+            RuntimeError(const Error& e, int line, int col, const Span& span): Error(e, line, col, "Runtime", span) {};
+    };
+
+    class InterruptError: public RuntimeError {
+        public:
+            InterruptError(const string& t, int line, int col): RuntimeError(ErrorCode::INTERRUPTED, t, line, col) {};
+    };
+
+    class MemoryError: public RuntimeError {
+        public:
+            MemoryError(const string& t): RuntimeError(ErrorCode::OUT_OF_MEMORY, t) {};
     };
 
     class BasicSyntaxError: public Error {
         public:
-            BasicSyntaxError(const string& t): Error(t) {};
+            BasicSyntaxError(const string& t): Error(ErrorCode::SYNTAX, t) {};
+            BasicSyntaxError(ErrorCode code, const string& t): Error(code, t) {};
     };
 
     class BasicRuntimeError: public Error {
         public:
             BasicRuntimeError(const string& t): Error(t) {};
+            BasicRuntimeError(ErrorCode code, const char* op, const string& a="", const string& b=""): Error(code, op, a, b) {};
     };
 }
 
@@ -448,6 +999,129 @@ namespace liteexpr {
 }
 
 
+/* ***************************************************************************
+* COLLECTOR
+*/
+
+namespace liteexpr {
+    struct Collected {
+        size_t examined;
+        size_t objects;
+        size_t bytes;
+    };
+
+    Collected collect(size_t budget=0);
+}
+
+
+/* ***************************************************************************
+* SNAPSHOT
+*/
+
+namespace liteexpr {
+    void save_snapshot(std::ostream& out, VALUE value);
+    void save_snapshot(const string& path, VALUE value);
+    VALUE load_snapshot(const string& path);
+}
+
+
+/* ***************************************************************************
+* DEPENDENCY GRAPH
+*/
+
+namespace liteexpr {
+    /*
+    * Named programs over a symbol table, each kept up to date with the
+    * symbols it reads.  A program's result is stored in the table under its
+    * name, where other programs may read it.  Setting a symbol in the table
+    * marks the programs that read it stale; update() evaluates them, and the
+    * programs that read what they changed, in dependency order.
+    */
+    class DependencyGraph {
+        struct Node {
+            shared_ptr<Compiled> program;
+            Dependencies deps;
+            VALUE result;
+            bool stale;
+            std::exception_ptr error;
+        };
+
+        SYMBOLS symbols;
+        map<string,Node> nodes;
+        vector<string> order;
+        bool updating;
+
+        void visit(const string& name, const map<string,std::set<string> >& writers, map<string,int>& marks);
+        void sort();
+        void invalidate(const string& k, size_t after);
+        bool evaluate(size_t i);
+
+        public:
+            DependencyGraph(SYMBOLS symbols);
+            DependencyGraph(const DependencyGraph&) = delete;
+            ~DependencyGraph();
+            void define(const string& name, const string& expr);
+            vector<string> update();
+            VALUE get(const string& name);
+    };
+}
+
+
+/* ***************************************************************************
+* RULE SET
+*/
+
+namespace liteexpr {
+    /*
+    * How much of a rule set is shared.  Subexpressions and their occurrences
+    * are counted when it is compiled; evaluations of them, and reuses of
+    * their values, over every evaluation of the set so far.
+    */
+    struct Sharing {
+        size_t subexpressions = 0;
+        size_t occurrences = 0;
+        size_t evaluated = 0;
+        size_t reused = 0;
+    };
+
+    /*
+    * How well a rule set's guards narrow it down.  Guards are counted when it
+    * is compiled; rules evaluated and skipped over every evaluation so far.
+    */
+    struct Indexing {
+        size_t guards = 0;
+        size_t evaluated = 0;
+        size_t skipped = 0;
+    };
+
+    class PredicateIndex;
+
+    /*
+    * Many programs compiled together and evaluated against the same symbols.
+    * Pure subexpressions that appear more than once, in one rule or several,
+    * are evaluated once per evaluation of the set.  An indexed set also skips
+    * the rules whose guards can't match.
+    */
+    class RuleSet {
+        vector<shared_ptr<Compiled> > rules;
+        vector<vector<string> > functions;
+        std::unordered_map<antlr4::tree::ParseTree*,size_t> slots;
+        Sharing sharing;
+        shared_ptr<PredicateIndex> index;
+        Indexing indexing;
+
+        bool pure(SYMBOLS symbols) const;
+
+        public:
+            RuleSet(const vector<string>& sources, bool indexed=false);
+            size_t size() const;
+            vector<VALUE> eval(SYMBOLS symbols, const Limits& limits=Limits());
+            const Sharing& getSharing() const;
+            const Indexing& getIndexing() const;
+    };
+}
+
+
 /* ***************************************************************************
 * HELPER FUNCTIONS
 */
@@ -465,6 +1139,14 @@ namespace liteexpr {
     ARRAY make_array(initializer_list<VALUE>);
     OBJECT make_object(initializer_list<pair<string,VALUE> >);
     SYMBOLS make_symbols(initializer_list<pair<string,VALUE> >);
+    TYPEDARRAY make_typed_array(const int64_t* data, size_t size, shared_ptr<const void> owner=nullptr);
+    TYPEDARRAY make_typed_array(const double* data, size_t size, shared_ptr<const void> owner=nullptr);
+    TYPEDARRAY map_typed_array(const string& path, ElementType element);
+    ARRAYVIEW make_array_view(const vector<string>& data, shared_ptr<const void> owner=nullptr);
+
+    template<typename T> OBJECTVIEW make_object_view(const T& data, const vector<Field<T> >& fields, shared_ptr<const void> owner=nullptr) {
+        return OBJECTVIEW(new StructView<T>(data, fields, owner));
+    }
 }
 
 
@@ -0,0 +1,105 @@
+#include <string>
+#include <iostream>
+#include <thread>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static void run(liteexpr::SYMBOLS symbols, const string& expr) {
+    try {
+        liteexpr::eval(expr, symbols);
+    }
+    catch(liteexpr::Error e) {
+        cout << string(e) << endl;
+    }
+}
+
+
+int main(int argc, const char* argv[]) {
+    liteexpr::Collected collected;
+
+    /* Nothing to collect at the start */
+    collected = liteexpr::collect();
+    cout << "initial: " << collected.objects << " objects" << endl;
+
+    /* A function stored in the scope it closes over is a cycle */
+    {
+        liteexpr::SYMBOLS symbols = liteexpr::make_symbols({});
+
+        run(symbols, R"(
+            fact = FUNCTION("?", IF(ARG[0] <= 1, 1, ARG[0] * fact(ARG[0]-1)));
+            self = { name: "self" };
+            self.me = self;
+            PRINT(fact(10));
+        )");
+
+        /* Still referenced by the host, so nothing is collected */
+        collected = liteexpr::collect();
+        cout << "while live: " << collected.objects << " objects" << endl;
+
+        run(symbols, "PRINT(self.name)");
+    }
+
+    collected = liteexpr::collect();
+    cout << "after release: " << (collected.objects > 0 ? "collected" : "leaked") << ", "
+         << (collected.bytes > 0 ? "bytes reported" : "no bytes") << endl;
+
+    collected = liteexpr::collect();
+    cout << "second pass: " << collected.objects << " objects" << endl;
+
+    /* Incremental collection in small steps */
+    {
+        liteexpr::SYMBOLS symbols = liteexpr::make_symbols({});
+
+        run(symbols, R"(
+            a = { };
+            b = { };
+            a.b = b;
+            b.a = a;
+            f = FUNCTION("", a);
+        )");
+    }
+
+    size_t objects = 0;
+
+    for(int i = 0; i < 100; i++) {
+        collected = liteexpr::collect(16);
+        objects += collected.objects;
+        if(collected.examined > 16) cout << "step examined " << collected.examined << endl;
+    }
+
+    cout << "incremental: " << (objects > 0 ? "collected" : "leaked") << endl;
+
+    collected = liteexpr::collect();
+    cout << "final: " << collected.objects << " objects" << endl;
+
+    /* Cycles made on other threads, kept alive past their thread by the host */
+    liteexpr::SYMBOLS kept;
+
+    {
+        std::thread first([&kept]() {
+            kept = liteexpr::make_symbols({});
+            run(kept, "a = { }; a.a = a; b = { }; b.b = b");
+        });
+        first.join();
+
+        std::thread second([]() {
+            liteexpr::SYMBOLS symbols = liteexpr::make_symbols({});
+            run(symbols, "c = { }; c.c = c");
+        });
+        second.join();
+    }
+
+    collected = liteexpr::collect();
+    cout << "threads: " << collected.objects << " objects" << endl;
+
+    kept.reset();
+    objects = 0;
+
+    for(int i = 0; i < 100; i++) objects += liteexpr::collect(16).objects;
+
+    cout << "threads incremental: " << objects << " objects" << endl;
+
+    return 0;
+}
@@ -0,0 +1,46 @@
+#include <string>
+#include <memory>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static void run(const string& expr, const liteexpr::Limits& limits) {
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({});
+
+    try {
+        string result = liteexpr::eval(expr, symbols, limits)->encoded();
+
+        cout << "=> " << result << endl;
+    }
+    catch(liteexpr::InterruptError e) {
+        cout << "interrupted: " << string(e) << endl;
+    }
+    catch(liteexpr::Error e) {
+        cout << "error: " << string(e) << endl;
+    }
+}
+
+
+int main(int argc, const char* argv[]) {
+    liteexpr::Limits steps;
+    liteexpr::Limits timeout;
+    liteexpr::Limits cancelled;
+
+    steps.steps = 1000;
+    timeout.timeout = std::chrono::milliseconds(50);
+    cancelled.cancellation = make_shared<liteexpr::Cancellation>();
+    cancelled.cancellation->cancel();
+
+    run("FOR(i=0, i<10, i++, i)", steps);
+    run("WHILE(1, 0)", steps);
+    run("i = 0;\nFOREACH(x, [1,2,3], i += x);\nFOR(i=0, 1, i++, i)", steps);
+    run("fib = FUNCTION(\"?\", ARG[0] < 2 ? ARG[0] : fib(ARG[0]-1) + fib(ARG[0]-2));\nfib(30)", steps);
+    run("EVAL(\"WHILE(1, 0)\")", steps);
+    run("x = 0;\nWHILE(1, x++)", timeout);
+    run("1 + 2", cancelled);
+    run("LEN([1, 2])", cancelled);
+
+    return 0;
+}
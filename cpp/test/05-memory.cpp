@@ -0,0 +1,67 @@
+#include <string>
+#include <memory>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static void run(const string& expr, const liteexpr::Limits& limits) {
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({});
+    liteexpr::Usage usage;
+    liteexpr::Limits metered = limits;
+
+    metered.usage = &usage;
+
+    try {
+        string result = liteexpr::eval(expr, symbols, metered)->encoded();
+
+        cout << "=> " << result << endl;
+    }
+    catch(liteexpr::MemoryError e) {
+        cout << "out of memory: " << string(e) << endl;
+    }
+    catch(liteexpr::Error e) {
+        cout << "error: " << string(e) << endl;
+    }
+
+    cout << "   peak " << (usage.peak > 0 ? "> 0" : "= 0")
+        << (limits.memory && usage.peak > limits.memory ? ", over the limit" : "")
+        << endl;
+}
+
+
+/* Values freed by a later evaluation are not refunded to it */
+static void reuse(const liteexpr::Limits& limits) {
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({});
+    liteexpr::Limits metered = limits;
+
+    for(const char* expr : { "a = []; FOR(i=0, i<100, i++, a[i] = \"a string too long to be stored inline \" + i); LEN(a)", "a = 0; o = {}", "o = 0" }) {
+        liteexpr::Usage usage;
+
+        metered.usage = &usage;
+
+        cout << "=> " << liteexpr::eval(expr, symbols, metered)->encoded() << endl;
+        cout << "   current " << (usage.current < 0 ? "< 0" : ">= 0") << endl;
+    }
+}
+
+
+int main(int argc, const char* argv[]) {
+    liteexpr::Limits unlimited;
+    liteexpr::Limits limited;
+
+    limited.memory = 100000;
+
+    run("1 + 2", unlimited);
+    run("s = \"x\";\nFOR(i=0, i<10, i++, s += s);\nLEN(s)", unlimited);
+    run("s = \"x\";\nWHILE(1, s += s)", limited);
+    run("a = [];\nWHILE(1, a[LEN(a)] = [1, 2, 3])", limited);
+    run("o = {};\nFOR(i=0, 1, i++, o[\"k\" + i] = i)", limited);
+    run("a = [];\nFOR(i=0, i<100, i++, a[i] = i);\nLEN(a)", limited);
+
+    limited.memory = 200000;
+    reuse(limited);
+
+    return 0;
+}
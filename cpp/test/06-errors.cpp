@@ -0,0 +1,47 @@
+#include <string>
+#include <memory>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static void run(const string& expr) {
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({});
+
+    try {
+        string result = liteexpr::eval(expr, symbols)->encoded();
+
+        cout << "=> " << result << endl;
+    }
+    catch(const liteexpr::Error& e) {
+        const liteexpr::Span& span = e.getSpan();
+        const char* op = e.getOperator();
+
+        cout << "code " << static_cast<int>(e.getCode())
+            << " at " << e.getLine() << ":" << e.getColumn()
+            << ", op " << (op ? op : "-")
+            << ", operands (" << e.getOperand(0) << "," << e.getOperand(1) << ")"
+            << endl;
+
+        if(span.source) {
+            cout << "  in `" << span.source->substr(span.start, span.stop - span.start) << "`" << endl;
+        }
+
+        cout << "  " << string(e) << endl;
+    }
+}
+
+
+int main(int argc, const char* argv[]) {
+    run("1 + [2]");
+    run("x = {};\nx - 1");
+    run("LEN( 1 + 2 )");
+    run("a = [1, 2];\nPRINT(a[5])");
+    run("5 % 0");
+    run("nothing(1)");
+    run("o = { x: 1 };\no.x + o.y");
+    run("CEIL(\"a\", # comment\n 2)");
+
+    return 0;
+}
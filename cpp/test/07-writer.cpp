@@ -0,0 +1,53 @@
+#include <string>
+#include <memory>
+#include <sstream>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+int main(int argc, const char* argv[]) {
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({});
+    liteexpr::VALUE value = liteexpr::eval(R"(
+        { name: "Alice\n\"A\"", grades: [90, 85.5, [], {}], tags: { a: [1, [2, 3]], b: 0.25 } }
+    )", symbols);
+
+    /* Pretty output is what encoded() returns */
+    {
+        ostringstream out;
+        liteexpr::Writer writer(out);
+
+        value->write(writer);
+        writer.flush();
+
+        cout << out.str() << endl;
+        cout << (out.str() == value->encoded() ? "same as encoded()" : "differs from encoded()") << endl;
+    }
+
+    /* Compact output, into a string */
+    {
+        string buffer;
+        liteexpr::Writer writer(buffer, liteexpr::Format::COMPACT);
+
+        value->write(writer);
+
+        cout << buffer << endl;
+    }
+
+    /* Output larger than a chunk reaches the stream whole */
+    {
+        liteexpr::VALUE big = liteexpr::eval("a = [];\nFOR(i=0, i<20000, i++, a[i] = [i, i / 3.0, \"x\"]);\na", symbols);
+        ostringstream out;
+
+        {
+            liteexpr::Writer writer(out);
+
+            big->write(writer);
+        }
+
+        cout << out.str().size() << " bytes, " << (out.str() == big->encoded() ? "same as encoded()" : "differs from encoded()") << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,69 @@
+#include <string>
+#include <memory>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static string evaluated(const string& text) {
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({});
+
+    try {
+        return liteexpr::eval(text, symbols)->encoded();
+    }
+    catch(const liteexpr::Error& e) {
+        return "error: " + string(e);
+    }
+}
+
+
+static void run(const string& text) {
+    liteexpr::VALUE value;
+
+    try {
+        value = liteexpr::parse_value(text);
+    }
+    catch(const liteexpr::Error& e) {
+        string error = "error: " + string(e);
+
+        cout << error << (error == evaluated(text) ? "  (same as eval)" : "  (differs from eval)") << endl;
+        return;
+    }
+
+    liteexpr::Writer out(cout, liteexpr::Format::COMPACT);
+
+    value->write(out);
+    out.put(value->encoded() == evaluated(text) ? "  (same as eval)\n" : "  (differs from eval)\n");
+}
+
+
+int main(int argc, const char* argv[]) {
+    run("");
+    run("42");
+    run("-7");
+    run("0x1F");
+    run("3.25");
+    run("-.5");
+    run("\"plain\"");
+    run("\"tab\\t, quote \\\", backslash \\\\, \\u00e9\"");
+    run("[1, 2.5, \"three\", [], {},]");
+    run("{ b: [1, { c: -2 }], a: \"x\", a: \"y\", }");
+    run("# reference data\n{\n    /* ids */ ids: [0x10, 0x20],\n    name: \"ref\" # trailing\n}\n");
+    run("[1, 2");
+    run("{ a: 1 } x");
+    run("[012]");
+    run("{ \"a\": 1 }");
+    run("--5");
+    run("-- 5");
+    run("+-5");
+    run("- -5");
+    run("1e5");
+    run("[1, 2.]");
+    run("-\"x\"");
+    run("[1, \"\\q\"]");
+    run("[1 >>= 2]");
+    run("[1, /* unterminated");
+
+    return 0;
+}
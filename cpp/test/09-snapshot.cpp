@@ -0,0 +1,134 @@
+#include <string>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static const string path = "09-snapshot.snap";
+
+
+static void run(liteexpr::SYMBOLS symbols, const string& expr) {
+    try {
+        cout << liteexpr::eval(expr, symbols)->encoded() << endl;
+    }
+    catch(const liteexpr::Error& e) {
+        cout << "error: " << string(e) << endl;
+    }
+}
+
+
+static void roundtrip(liteexpr::VALUE value) {
+    try {
+        liteexpr::save_snapshot(path, value);
+
+        liteexpr::VALUE loaded = liteexpr::load_snapshot(path);
+        liteexpr::Writer out(cout, liteexpr::Format::COMPACT);
+
+        loaded->write(out);
+        out.put(loaded->encoded() == value->encoded() ? "  (same)\n" : "  (differs)\n");
+    }
+    catch(const liteexpr::Error& e) {
+        cout << "error: " << string(e) << endl;
+    }
+}
+
+
+int main(int argc, const char* argv[]) {
+    /* Plain values */
+    roundtrip(liteexpr::make_value(42));
+    roundtrip(liteexpr::make_value(-2.5));
+    roundtrip(liteexpr::make_value("text with \"quotes\""));
+    roundtrip(liteexpr::parse_value("[1, [2, [3]], {}, \"\", { b: 1, a: [0.5] }]"));
+
+    /* Members are looked up in the snapshot as they are used */
+    {
+        liteexpr::save_snapshot(path, liteexpr::parse_value("{ rates: { EUR: 0.9, GBP: 0.8 }, codes: [\"EUR\", \"GBP\"] }"));
+
+        liteexpr::SYMBOLS symbols = liteexpr::make_symbols({ { "ref", liteexpr::load_snapshot(path) } });
+
+        run(symbols, "ref.rates.GBP * 100");
+        run(symbols, "ref.rates.USD = 1; ref.rates");
+        run(symbols, "LEN(ref.codes)");
+    }
+
+    /* Values referred to twice are loaded once, even in a cycle */
+    {
+        liteexpr::SYMBOLS symbols = liteexpr::make_symbols({});
+
+        liteexpr::eval("node = { n: 1 }; node.self = node; data = { p: node, q: node }", symbols);
+        liteexpr::save_snapshot(path, symbols->get("data"));
+        symbols->set("data", liteexpr::load_snapshot(path));
+
+        run(symbols, "data.p.self.self.n");
+        run(symbols, "data.p.n = 2; data.q.n");
+    }
+
+    /* A scope is saved with the scopes it is nested in, but not functions */
+    {
+        liteexpr::SYMBOLS global = liteexpr::make_symbols({ { "base", liteexpr::make_value(10) } });
+        liteexpr::SYMBOLS local = make_shared<liteexpr::SymbolTable>(global);
+
+        liteexpr::eval("double = FUNCTION(\"?\", ARG[0] * 2)", global);
+        local->set("offset", liteexpr::make_value(5));
+        liteexpr::save_snapshot(path, local);
+
+        liteexpr::SYMBOLS loaded = dynamic_pointer_cast<liteexpr::SymbolTable>(liteexpr::load_snapshot(path));
+
+        run(loaded, "base + offset");
+        run(loaded, "base = 20; UPSCOPE.base");
+        run(loaded, "SQRT(16)");
+        run(loaded, "double(1)");
+    }
+
+    /* Scopes may share a parent, or be nested in the value saved */
+    {
+        liteexpr::SYMBOLS global = liteexpr::make_symbols({ { "base", liteexpr::make_value(10) } });
+        liteexpr::SYMBOLS first = make_shared<liteexpr::SymbolTable>(global);
+        liteexpr::SYMBOLS second = make_shared<liteexpr::SymbolTable>(global);
+
+        first->set("offset", liteexpr::make_value(1));
+        second->set("offset", liteexpr::make_value(2));
+        global->set("scopes", liteexpr::make_value({ first, second }));
+        liteexpr::save_snapshot(path, liteexpr::make_value({ first, second }));
+
+        liteexpr::VALUE loaded = liteexpr::load_snapshot(path);
+        liteexpr::SYMBOLS symbols = liteexpr::make_symbols({ { "scopes", loaded } });
+
+        run(symbols, "scopes[0].offset + scopes[0].UPSCOPE.base + scopes[1].offset");
+        run(symbols, "scopes[0].UPSCOPE.base = 20; scopes[1].UPSCOPE.base");
+
+        liteexpr::save_snapshot(path, global);
+        symbols = dynamic_pointer_cast<liteexpr::SymbolTable>(liteexpr::load_snapshot(path));
+
+        run(symbols, "scopes[1].offset + scopes[1].UPSCOPE.base");
+    }
+
+    /* Functions on their own cannot be saved */
+    roundtrip(liteexpr::make_symbols({})->get("SQRT"));
+
+    /* Files that are not snapshots */
+    {
+        ofstream(path, ios::binary) << "not a snapshot";
+
+        try {
+            liteexpr::load_snapshot(path);
+        }
+        catch(const liteexpr::Error& e) {
+            cout << "error: " << string(e) << endl;
+        }
+
+        try {
+            liteexpr::load_snapshot("no-such-file.snap");
+        }
+        catch(const liteexpr::Error& e) {
+            cout << "error: " << string(e) << endl;
+        }
+    }
+
+    remove(path.c_str());
+
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <string>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <fstream>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static const string path = "10-compiled.lec";
+
+
+static void run(const string& file) {
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({});
+
+    try {
+        liteexpr::Compiled compiled = liteexpr::load_compiled(file);
+
+        cout << compiled.eval(symbols)->encoded() << endl;
+    }
+    catch(const liteexpr::Error& e) {
+        cout << "error: " << string(e) << endl;
+    }
+}
+
+
+static void patch(size_t offset, char byte) {
+    fstream file(path, ios::in | ios::out | ios::binary);
+
+    file.seekp(offset);
+    file.put(byte);
+}
+
+
+/* Overwrite the word that ends `back` bytes before the end of the tree, and
+* sign the file again so only its shape is wrong */
+static void reshape(size_t back, uint64_t word) {
+    stringstream buffer;
+
+    buffer << ifstream(path, ios::binary).rdbuf();
+
+    string data = buffer.str();
+    uint64_t hash = 0xcbf29ce484222325;
+
+    memcpy(&data[data.size() - back], &word, sizeof(word));
+
+    for(size_t i = 32; i < data.size(); i++) {
+        hash ^= static_cast<unsigned char>(data[i]);
+        hash *= 0x100000001b3;
+    }
+
+    memcpy(&data[24], &hash, sizeof(hash));
+    ofstream(path, ios::binary) << data;
+}
+
+
+int main(int argc, const char* argv[]) {
+    /* Programs run the same loaded as compiled */
+    liteexpr::compile(R"(
+        # comments are kept in the source, not in the tree
+        fib = FUNCTION("?", ARG[0] < 2 ? ARG[0] : fib(ARG[0]-1) + fib(ARG[0]-2));
+        i = 0; s = ""; v = [1, { b: 2.5 }];
+        WHILE(i++ < 3, s += "x");
+        { fib: fib(15), s: s, t: -(2 ** 3) % 5, e: EVAL("1 + 2"), a: v[1].b }
+    )").save(path);
+    run(path);
+
+    /* Errors give where they happened in the source */
+    liteexpr::compile("x = 1;\ny = x + \"a\" * 2").save(path);
+    run(path);
+
+    /* Files from another version are compiled from their source */
+    liteexpr::compile("6 * 7").save(path);
+    patch(8, 99);
+    run(path);
+
+    /* Damaged files are rejected */
+    liteexpr::compile("6 * 7").save(path);
+    patch(44, '9');
+    run(path);
+
+    /* Trees the grammar can't make are compiled from their source: the 7 as
+    * a STRING, and with no start token */
+    liteexpr::compile("6 * 7").save(path);
+    reshape(64, 2);
+    run(path);
+
+    liteexpr::compile("6 * 7").save(path);
+    reshape(48, ~uint64_t(0));
+    run(path);
+
+    ofstream(path, ios::binary) << "not compiled";
+    run(path);
+
+    run("no-such-file.lec");
+
+    remove(path.c_str());
+
+    return 0;
+}
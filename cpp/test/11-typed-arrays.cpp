@@ -0,0 +1,78 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <fstream>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static const string path = "11-typed-arrays.bin";
+
+
+static void run(liteexpr::SYMBOLS symbols, const string& expr) {
+    try {
+        string result = liteexpr::eval(expr, symbols)->encoded();
+
+        cout << expr << " => " << result << endl;
+    }
+    catch(const liteexpr::Error& e) {
+        cout << expr << " => error: " << string(e) << endl;
+    }
+}
+
+
+int main(int argc, const char* argv[]) {
+    /* A table in a file of native-endian 64-bit integers */
+    {
+        ofstream file(path, ios::binary);
+
+        for(int64_t i = 0; i < 1000; i++) {
+            int64_t square = i * i;
+
+            file.write(reinterpret_cast<const char*>(&square), sizeof(square));
+        }
+    }
+
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({
+        { "squares", liteexpr::map_typed_array(path, liteexpr::ElementType::INT64) },
+    });
+
+    run(symbols, "LEN(squares)");
+    run(symbols, "squares[12] + squares[999]");
+    run(symbols, "sum = 0; FOREACH(v, squares, sum += v); sum");
+    run(symbols, "i = 0; n = 0; FOR(i = 0, i < LEN(squares), i++, n += squares[i] % 2); n");
+    run(symbols, "squares[1000]");
+    run(symbols, "squares[-1]");
+    run(symbols, "squares[0] = 1");
+    run(symbols, "squares[2] += 1");
+
+    /* A host buffer, kept alive by the array */
+    {
+        auto rates = make_shared<vector<double> >(vector<double>{ 0.5, 1.25, 2.0 });
+
+        symbols->set("rates", liteexpr::make_typed_array(rates->data(), rates->size(), rates));
+    }
+
+    run(symbols, "rates");
+    run(symbols, "rates[1] * 4");
+    run(symbols, "rates == [0.5, 1.25, 2.0]");
+    run(symbols, "rates != [0.5, 1.25]");
+    run(symbols, "rates == rates");
+    run(symbols, "rates ? \"nonempty\" : \"empty\"");
+
+    /* Files that are not a whole number of elements */
+    ofstream(path, ios::binary) << "12345";
+
+    try {
+        liteexpr::map_typed_array(path, liteexpr::ElementType::DOUBLE);
+    }
+    catch(const liteexpr::Error& e) {
+        cout << "error: " << string(e) << endl;
+    }
+
+    remove(path.c_str());
+
+    return 0;
+}
@@ -0,0 +1,83 @@
+#include <string>
+#include <vector>
+#include <memory>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+struct Trade {
+    string symbol;
+    double price;
+    int64_t quantity;
+    vector<string> tags;
+};
+
+static const vector<liteexpr::Field<Trade> > TRADE_FIELDS = {
+    { "symbol"  , [](const Trade& t) { return liteexpr::make_value(t.symbol); } },
+    { "price"   , [](const Trade& t) { return liteexpr::make_value(t.price); } },
+    { "quantity", [](const Trade& t) { return liteexpr::make_value(t.quantity); } },
+    { "tags"    , [](const Trade& t) { return liteexpr::VALUE(liteexpr::make_array_view(t.tags)); } },
+};
+
+
+static void run(liteexpr::SYMBOLS symbols, const string& expr) {
+    try {
+        string result = liteexpr::eval(expr, symbols)->encoded();
+
+        cout << expr << " => " << result << endl;
+    }
+    catch(const liteexpr::Error& e) {
+        cout << expr << " => error: " << string(e) << endl;
+    }
+}
+
+
+int main(int argc, const char* argv[]) {
+    Trade trade = { "ACME", 12.5, 100, { "equity", "us" } };
+    vector<string> desks = { "rates", "fx", "credit" };
+    vector<double> weights = { 0.25, 0.75 };
+
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({
+        { "trade", liteexpr::make_object_view(trade, TRADE_FIELDS) },
+        { "desks", liteexpr::make_array_view(desks) },
+        { "weights", liteexpr::make_typed_array(weights.data(), weights.size()) },
+    });
+
+    /* Reads go to the host data */
+    run(symbols, "trade.price * trade.quantity");
+    run(symbols, "trade.tags[1] + \"/\" + desks[LEN(desks)-1]");
+    run(symbols, "n = \"\"; FOREACH(kv, trade, n += kv[0] + \";\"); n");
+    run(symbols, "s = \"\"; FOREACH(d, desks, s += d); s");
+    run(symbols, "weights[0] + weights[1]");
+    run(symbols, "trade.missing");
+    run(symbols, "desks == [\"rates\", \"fx\", \"credit\"]");
+    run(symbols, "p = trade; p == trade");
+    run(symbols, "desks != desks");
+    run(symbols, "trade");
+
+    trade.price = 13.0;
+    desks[1] = "fx-spot";
+    run(symbols, "[trade.price, desks[1]]");
+
+    /* Views are read-only unless copy-on-write */
+    run(symbols, "trade.price = 1");
+    run(symbols, "desks[0] = \"none\"");
+
+    {
+        liteexpr::OBJECTVIEW view = liteexpr::make_object_view(trade, TRADE_FIELDS);
+        liteexpr::ARRAYVIEW list = liteexpr::make_array_view(desks);
+
+        view->setCopyOnWrite(true);
+        list->setCopyOnWrite(true);
+        symbols->set("mine", view);
+        symbols->set("list", list);
+    }
+
+    run(symbols, "mine.price = 1; mine.note = \"copied\"; [mine.price, mine.note, LEN(mine)]");
+    run(symbols, "list[3] = \"equities\"; list");
+    cout << "host: " << trade.price << " " << desks.size() << endl;
+
+    return 0;
+}
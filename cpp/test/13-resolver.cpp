@@ -0,0 +1,54 @@
+#include <map>
+#include <string>
+#include <memory>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+/* Stands in for a database or cache, counting how often it is asked */
+static map<string,liteexpr::VALUE> store = {
+    { "price"   , liteexpr::make_value(12.5) },
+    { "quantity", liteexpr::make_value(100) },
+    { "country" , liteexpr::make_value("NZ") },
+    { "limits"  , liteexpr::make_value({ { "max", liteexpr::make_value(5000) } }) },
+};
+static map<string,int> fetches;
+
+
+static void run(liteexpr::SYMBOLS symbols, const string& expr) {
+    try {
+        string result = liteexpr::eval(expr, symbols)->encoded();
+
+        cout << expr << " => " << result << endl;
+    }
+    catch(const liteexpr::Error& e) {
+        cout << expr << " => error: " << string(e) << endl;
+    }
+}
+
+
+int main(int argc, const char* argv[]) {
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({});
+
+    symbols->setResolver([](const string& k) -> liteexpr::VALUE {
+        auto found = store.find(k);
+
+        fetches[k]++;
+
+        return (found != store.end()) ? found->second : nullptr;
+    });
+
+    /* Only the symbols a rule reads are fetched, each once */
+    run(symbols, "price * quantity");
+    run(symbols, "price * quantity <= limits.max");
+    run(symbols, "f = FUNCTION(\"\", price + 1); f() + f()");
+    run(symbols, "missing");
+    run(symbols, "missing = 1; missing");
+    run(symbols, "x = 2; y = x * price");
+
+    for(const auto& fetch : fetches) cout << fetch.first << ": " << fetch.second << endl;
+
+    return 0;
+}
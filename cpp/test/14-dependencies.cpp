@@ -0,0 +1,44 @@
+#include <set>
+#include <string>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static string join(const set<string>& names) {
+    string joined;
+
+    for(const string& name : names) joined += (joined.empty() ? "" : " ") + name;
+
+    return "[" + joined + "]";
+}
+
+
+static void show(const string& expr) {
+    liteexpr::Dependencies deps = liteexpr::compile(expr).dependencies();
+
+    cout << expr << endl;
+    cout << "    reads  " << join(deps.reads) << endl;
+    cout << "    writes " << join(deps.writes) << endl;
+    cout << "    calls  " << join(deps.calls) << endl;
+    if(deps.unknown) cout << "    unknown" << endl;
+}
+
+
+int main(int argc, const char* argv[]) {
+    show("price * quantity");
+    show("order.price * order.quantity <= limits.max");
+    show("rates[order.currency] * order.total");
+    show("total = price * quantity; total > limit ? total * 0.9 : total");
+    show("IF(vip, discount = 0.2); price * (1 - discount)");
+    show("count += 1; seen.last = now");
+    show("sum = 0; FOREACH(item, cart, sum += item.price); ROUND(sum)");
+    show("FOR(i = 0, i < n, i++, PRINT(i))");
+    show("tax = FUNCTION(\"?\", ARG[0] * rate); tax(price)");
+    show("ok || fallback(reason)");
+    show("EVAL(rule)");
+    show("GLOBAL.x + 1");
+
+    return 0;
+}
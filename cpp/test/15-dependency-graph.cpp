@@ -0,0 +1,116 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static void update(liteexpr::DependencyGraph& graph) {
+    vector<string> evaluated = graph.update();
+    string names;
+
+    for(const string& name : evaluated) names += (names.empty() ? "" : " ") + name;
+
+    cout << "evaluated [" << names << "]" << endl;
+}
+
+
+static void show(liteexpr::DependencyGraph& graph, const string& name) {
+    cout << name << " = " << graph.get(name)->encoded() << endl;
+}
+
+
+int main(int argc, const char* argv[]) {
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({
+        { "price"    , liteexpr::make_value(10) },
+        { "quantity" , liteexpr::make_value(3) },
+        { "rate"     , liteexpr::make_value(0.15) },
+        { "shipping" , liteexpr::make_value(5) },
+        { "order"    , liteexpr::make_value({ { "vip", liteexpr::make_value(0) } }) },
+    });
+    liteexpr::DependencyGraph graph(symbols);
+
+    /* Defined out of order; evaluated in dependency order */
+    graph.define("total", "subtotal + tax + shipping");
+    graph.define("tax", "ROUND(subtotal * rate)");
+    graph.define("subtotal", "price * quantity * (order.vip ? 0.9 : 1)");
+    graph.define("big", "total > 100");
+
+    update(graph);
+    show(graph, "total");
+    show(graph, "big");
+
+    /* Nothing changed, nothing evaluated */
+    update(graph);
+
+    /* Only what reads shipping, and what reads that */
+    symbols->set("shipping", liteexpr::make_value(7));
+    update(graph);
+    show(graph, "total");
+
+    /* tax is unchanged, so big is not evaluated again */
+    symbols->set("rate", liteexpr::make_value(0.151));
+    update(graph);
+
+    /* The whole chain */
+    symbols->set("quantity", liteexpr::make_value(12));
+    update(graph);
+    show(graph, "total");
+    show(graph, "big");
+
+    /* Member paths depend on their symbol */
+    symbols->set("order", liteexpr::make_value({ { "vip", liteexpr::make_value(1) } }));
+    update(graph);
+    show(graph, "subtotal");
+
+    /* Assignments through the table count as updates */
+    liteexpr::eval("price = 20", symbols);
+    update(graph);
+    show(graph, "total");
+
+    /* Programs that read anything are evaluated after every update */
+    graph.define("report", "EVAL(\"total * 2\")");
+    update(graph);
+    symbols->set("unrelated", liteexpr::make_value(1));
+    update(graph);
+
+    /* Circles are refused, and the graph is left as it was */
+    try {
+        graph.define("subtotal", "total - tax - shipping");
+    }
+    catch(const liteexpr::Error& e) {
+        cout << "error: " << string(e) << endl;
+    }
+
+    symbols->set("price", liteexpr::make_value(10));
+    update(graph);
+    show(graph, "subtotal");
+
+    /* A program that fails keeps its error, and only what depends on it fails */
+    liteexpr::DependencyGraph failing(liteexpr::make_symbols({ { "v", liteexpr::make_value(1) } }));
+
+    failing.define("a", "b + 1");
+    failing.define("c", "a * 2");
+    failing.define("w", "v + 1");
+
+    try {
+        failing.define("b", "a + 1");
+    }
+    catch(const liteexpr::Error& e) {
+        cout << "error: " << string(e) << endl;
+    }
+
+    for(const string& name : { "w", "c", "a", "w" }) {
+        try {
+            string encoded = failing.get(name)->encoded();
+
+            cout << name << " = " << encoded << endl;
+        }
+        catch(const liteexpr::Error& e) {
+            cout << name << ": error: " << string(e) << endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static void run(liteexpr::RuleSet& rules, liteexpr::SYMBOLS record) {
+    vector<liteexpr::VALUE> results = rules.eval(record);
+    const liteexpr::Sharing& sharing = rules.getSharing();
+
+    for(size_t i = 0; i < results.size(); i++) {
+        cout << "rule " << i << " => " << results[i]->encoded() << endl;
+    }
+
+    cout << "evaluated " << sharing.evaluated << ", reused " << sharing.reused << endl;
+}
+
+
+static liteexpr::VALUE bump(vector<LiteExprParser::ExprContext*>& vexpr, liteexpr::Evaluator* visitor) {
+    visitor->getSymbols()->set("b", liteexpr::make_value(100));
+
+    return liteexpr::make_value(0);
+}
+
+
+int main(int argc, const char* argv[]) {
+    liteexpr::RuleSet rules({
+        "order.total * fx[order.ccy] > 1000",
+        "order.total * fx[order.ccy] < 10",
+        "LEN(items) > 0 && order.total * fx[order.ccy] > 500",
+        "LEN(items) > 0 ? items[0] : \"none\"",
+        "n = LEN(items); n * 2",
+        "ROUND(order.total * fx[order.ccy])",
+    });
+    const liteexpr::Sharing& sharing = rules.getSharing();
+
+    cout << rules.size() << " rules, " << sharing.subexpressions << " shared subexpressions in " << sharing.occurrences << " places" << endl;
+
+    run(rules, liteexpr::make_symbols({
+        { "order" , liteexpr::make_value({ { "total", liteexpr::make_value(800) }, { "ccy", liteexpr::make_value("EUR") } }) },
+        { "fx"    , liteexpr::make_value({ { "EUR", liteexpr::make_value(1.5) }, { "USD", liteexpr::make_value(1) } }) },
+        { "items" , liteexpr::make_value({ liteexpr::make_value("book") }) },
+    }));
+
+    run(rules, liteexpr::make_symbols({
+        { "order" , liteexpr::make_value({ { "total", liteexpr::make_value(5) }, { "ccy", liteexpr::make_value("USD") } }) },
+        { "fx"    , liteexpr::make_value({ { "EUR", liteexpr::make_value(1.5) }, { "USD", liteexpr::make_value(1) } }) },
+        { "items" , liteexpr::make_array({}) },
+    }));
+
+    /* A rule that writes a symbol keeps others from sharing what reads it */
+    liteexpr::RuleSet writing({
+        "total * 2",
+        "total = total + 1; total * 2",
+        "total * 2",
+    });
+
+    cout << writing.getSharing().subexpressions << " shared subexpressions" << endl;
+    run(writing, liteexpr::make_symbols({ { "total", liteexpr::make_value(1) } }));
+
+    /* Nothing is shared when a rule calls a host function that isn't pure */
+    liteexpr::RuleSet calling({
+        "a * 2 + b",
+        "bump(); a * 2 + b",
+    });
+
+    run(calling, liteexpr::make_symbols({
+        { "a"    , liteexpr::make_value(3) },
+        { "b"    , liteexpr::make_value(1) },
+        { "bump" , liteexpr::VALUE(new liteexpr::Function(bump, 0, 0)) },
+    }));
+
+    return 0;
+}
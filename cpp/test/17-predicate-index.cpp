@@ -0,0 +1,118 @@
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+/* A fixed sequence, so the output doesn't change */
+static uint64_t seed = 42;
+
+static size_t pick(size_t n) {
+    seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+
+    return (seed >> 33) % n;
+}
+
+
+static const vector<string> regions = { "EU", "US", "APAC", "LATAM" };
+
+
+static string make_rule() {
+    string region = "\"" + regions[pick(regions.size())] + "\"";
+    string tier = to_string(pick(5));
+
+    switch(pick(6)) {
+        case 0: return "region == " + region + " && tier >= " + tier;
+        case 1: return "region != " + region + " && order.total > " + to_string(pick(1000)) + " && LEN(items) > 1";
+        case 2: return tier + " < tier && order.total <= " + to_string(pick(1000)) + ".5";
+        case 3: return "order.ccy == \"EUR\" && order.total * 2 > " + to_string(pick(2000));
+        case 4: return "LEN(items) > 2 && region == " + region;
+        default: return "tier == -" + tier + " || region == " + region;
+    }
+}
+
+
+static liteexpr::SYMBOLS make_record(size_t i) {
+    liteexpr::VALUE tier = (i % 17 == 0) ? liteexpr::make_value("gold") : liteexpr::make_value(int64_t(pick(5)));
+    liteexpr::VALUE total = (i % 2) ? liteexpr::make_value(int64_t(pick(1000))) : liteexpr::make_value(pick(100000) / 100.0);
+    vector<liteexpr::VALUE> items(pick(4), liteexpr::make_value("item"));
+    liteexpr::SYMBOLS record = liteexpr::make_symbols({
+        { "tier"   , tier },
+        { "order"  , liteexpr::make_value({ { "total", total }, { "ccy", liteexpr::make_value(i % 3 ? "EUR" : "USD") } }) },
+        { "items"  , liteexpr::VALUE(new liteexpr::Array(items)) },
+    });
+
+    /* Some records have no region at all */
+    if(i % 11) record->set("region", liteexpr::make_value(regions[pick(regions.size())]));
+
+    return record;
+}
+
+
+static string run(liteexpr::RuleSet& rules, liteexpr::SYMBOLS record) {
+    try {
+        string encoded;
+
+        for(auto& result : rules.eval(record)) encoded += result->encoded() + ",";
+
+        return encoded;
+    }
+    catch(const liteexpr::Error& e) {
+        return "error: " + string(e);
+    }
+}
+
+
+static liteexpr::VALUE setregion(vector<LiteExprParser::ExprContext*>& vexpr, liteexpr::Evaluator* visitor) {
+    visitor->getSymbols()->set("region", liteexpr::make_value("EU"));
+
+    return liteexpr::make_value(0);
+}
+
+
+int main(int argc, const char* argv[]) {
+    vector<string> sources;
+    size_t differences = 0;
+    size_t errors = 0;
+
+    for(int i = 0; i < 2000; i++) sources.push_back(make_rule());
+
+    liteexpr::RuleSet brute(sources);
+    liteexpr::RuleSet indexed(sources, true);
+
+    cout << indexed.size() << " rules, " << indexed.getIndexing().guards << " guards" << endl;
+
+    for(size_t i = 0; i < 200; i++) {
+        liteexpr::SYMBOLS record = make_record(i);
+        string expected = run(brute, record);
+        string actual = run(indexed, record);
+
+        if(expected.rfind("error", 0) == 0) errors++;
+        if(expected != actual) differences++;
+    }
+
+    const liteexpr::Indexing& indexing = indexed.getIndexing();
+
+    cout << "records with errors: " << errors << endl;
+    cout << "differences: " << differences << endl;
+    cout << "evaluated " << indexing.evaluated << ", skipped " << indexing.skipped << endl;
+
+    /* A rule without guards is always evaluated */
+    liteexpr::RuleSet mixed({ "region == \"EU\"", "\"EU\" == region && tier > 2", "tier > 2 && region == \"EU\"", "PRINT(region)" }, true);
+
+    cout << run(mixed, liteexpr::make_symbols({ { "region", liteexpr::make_value("US") }, { "tier", liteexpr::make_value(3) } })) << endl;
+    cout << "evaluated " << mixed.getIndexing().evaluated << ", skipped " << mixed.getIndexing().skipped << endl;
+
+    /* Guards aren't decided up front when a rule calls a function that isn't pure */
+    liteexpr::RuleSet calling({ "setregion() + 0", "region == \"EU\" && 1" }, true);
+
+    cout << run(calling, liteexpr::make_symbols({
+        { "region"    , liteexpr::make_value("US") },
+        { "setregion" , liteexpr::VALUE(new liteexpr::Function(setregion, 0, 0)) },
+    })) << endl;
+
+    return 0;
+}
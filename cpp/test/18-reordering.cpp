@@ -0,0 +1,105 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static void show(const liteexpr::Compiled& compiled) {
+    for(const liteexpr::Chain& chain : compiled.getChains()) {
+        cout << "chain " << chain.op << " evaluated " << chain.evaluations << (chain.fixed ? " (fixed)" : "") << endl;
+
+        for(size_t i : chain.order) {
+            const liteexpr::Operand& operand = chain.operands[i];
+
+            cout << "    " << operand.source << ": evaluated " << operand.evaluated << ", decided " << operand.decided << ", cost " << operand.cost << endl;
+        }
+    }
+}
+
+
+static string run(liteexpr::Compiled& compiled, liteexpr::SYMBOLS symbols) {
+    try {
+        return compiled.eval(symbols)->encoded();
+    }
+    catch(const liteexpr::Error& e) {
+        return "error: " + string(e);
+    }
+}
+
+
+int main(int argc, const char* argv[]) {
+    string source = "ROUND(SQRT(x * x + y * y + z * z)) > 10 && LEN(items) > 0 && region == \"EU\" || vip == 1";
+    liteexpr::Compiled written = liteexpr::compile(source);
+    liteexpr::Compiled adaptive = liteexpr::compile(source);
+    const vector<string> regions = { "US", "US", "APAC", "EU", "US", "LATAM", "APAC" };
+    size_t differences = 0;
+
+    adaptive.setReordering(true);
+
+    for(int i = 0; i < 1000; i++) {
+        liteexpr::SYMBOLS record = liteexpr::make_symbols({
+            { "x"      , liteexpr::make_value(i % 13) },
+            { "y"      , liteexpr::make_value(i % 7) },
+            { "z"      , liteexpr::make_value(i % 5) },
+            { "items"  , i % 4 ? liteexpr::make_value({ liteexpr::make_value(i) }) : liteexpr::make_array({}) },
+            { "region" , liteexpr::make_value(regions[i % regions.size()]) },
+            { "vip"    , liteexpr::make_value(i % 50 == 0) },
+        });
+
+        if(run(written, record) != run(adaptive, record)) differences++;
+    }
+
+    cout << "differences: " << differences << endl;
+    show(adaptive);
+
+    /* An operand that fails out of order puts the chain back in its
+    * written order, and the error is the one it would have been */
+    liteexpr::Compiled failing = liteexpr::compile("LEN(name) > 0 && count < 0");
+
+    failing.setReordering(true);
+
+    for(int i = 0; i < 200; i++) {
+        run(failing, liteexpr::make_symbols({ { "name", liteexpr::make_value("x") }, { "count", liteexpr::make_value(i) } }));
+    }
+
+    show(failing);
+    cout << run(failing, liteexpr::make_symbols({ { "name", liteexpr::make_value("x") }, { "count", liteexpr::make_value("none") } })) << endl;
+    show(failing);
+
+    /* A chain decided early skips an operand that would have failed as written */
+    string hiding = "LEN(name)+LEN(name)+LEN(name) > 0 && count < 0";
+    liteexpr::Compiled hidingWritten = liteexpr::compile(hiding);
+    liteexpr::Compiled hidingAdaptive = liteexpr::compile(hiding);
+
+    hidingAdaptive.setReordering(true);
+
+    for(int i = 0; i < 200; i++) {
+        run(hidingAdaptive, liteexpr::make_symbols({ { "name", liteexpr::make_value("x") }, { "count", liteexpr::make_value(i) } }));
+    }
+
+    liteexpr::SYMBOLS invalid = liteexpr::make_symbols({ { "name", liteexpr::make_value(5) }, { "count", liteexpr::make_value(3) } });
+
+    cout << "written: " << run(hidingWritten, invalid) << endl;
+    cout << "reordered: " << run(hidingAdaptive, invalid) << endl;
+
+    /* Operands that aren't pure predicates are left alone */
+    liteexpr::Compiled impure = liteexpr::compile("x > 1 && (n = 2) && PRINT(x)");
+
+    impure.setReordering(true);
+    run(impure, liteexpr::make_symbols({ { "x", liteexpr::make_value(2) } }));
+    cout << "impure chains: " << impure.getChains().size() << endl;
+
+    /* Chains in functions defined by other programs are evaluated as written */
+    liteexpr::SYMBOLS shared = liteexpr::make_symbols({ { "x", liteexpr::make_value(3) } });
+    liteexpr::Compiled defining = liteexpr::compile("check = FUNCTION(\"\", x > 1 && x < 5 && LEN(\"a longer source\") > 0)");
+    liteexpr::Compiled calling = liteexpr::compile("check()");
+
+    calling.setReordering(true);
+    run(defining, shared);
+    cout << run(calling, shared) << endl;
+    cout << "calling chains: " << calling.getChains().size() << endl;
+
+    return 0;
+}
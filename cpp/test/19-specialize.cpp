@@ -0,0 +1,83 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static string run(liteexpr::Compiled& compiled, liteexpr::SYMBOLS symbols) {
+    try {
+        return compiled.eval(symbols)->encoded();
+    }
+    catch(const liteexpr::Error& e) {
+        return "error: " + string(e);
+    }
+}
+
+
+static void specialize(const string& source, liteexpr::SYMBOLS constants) {
+    try {
+        liteexpr::Compiled specialized = liteexpr::compile(source, constants);
+
+        cout << source << endl << "    => " << specialized.getSource() << endl;
+    }
+    catch(const liteexpr::Error& e) {
+        cout << source << endl << "    error: " << string(e) << endl;
+    }
+}
+
+
+int main(int argc, const char* argv[]) {
+    liteexpr::SYMBOLS constants = liteexpr::make_symbols({
+        { "threshold" , liteexpr::make_value(100) },
+        { "region"    , liteexpr::make_value("EU") },
+        { "debug"     , liteexpr::make_value(0) },
+        { "discount"  , liteexpr::make_value(-0.125) },
+        { "weights"   , liteexpr::make_value({ { "gold", liteexpr::make_value(3) }, { "silver", liteexpr::make_value(2) } }) },
+        { "tiers"     , liteexpr::make_value({ liteexpr::make_value("gold"), liteexpr::make_value("silver") }) },
+    });
+
+    specialize("amount * weights.gold > threshold * 2", constants);
+    specialize("IF(region == \"US\", amount * 1.07, region == \"EU\", amount * 1.2, amount)", constants);
+    specialize("IF(debug, PRINT(amount)); amount * (1 + discount)", constants);
+    specialize("debug ? amount : LEN(tiers) + weights[tier]", constants);
+    specialize("IF(amount > threshold, \"high\", debug, \"debug\", region == \"EU\", \"eu\", \"other\")", constants);
+    specialize("region == \"EU\" && amount > threshold", constants);
+    specialize("debug && amount > threshold", constants);
+    specialize("SQRT(threshold) + ROUND(weights.gold / 2.0)", constants);
+    specialize("f = FUNCTION(ARG[0] * weights.silver); f(amount) + threshold", constants);
+    specialize("FOREACH(tier, tiers, total += weights[tier] * amount); total", constants);
+
+    /* Constants cannot be assigned, and EVAL could read or write anything */
+    specialize("threshold = 5; amount > threshold", constants);
+    specialize("weights.gold++", constants);
+    specialize("EVAL(\"threshold\")", constants);
+
+    /* Built-ins are not constants, so a program may assign their names */
+    specialize("LEN = 3; LEN * threshold", constants);
+
+    /* The specialized program gives the same results */
+    string source = "IF(region == \"EU\", amount * weights[tier] * (1 + discount), amount) > threshold";
+    liteexpr::Compiled general = liteexpr::compile(source);
+    liteexpr::Compiled specialized = general.specialize(constants);
+
+    cout << specialized.getSource() << endl;
+
+    for(int64_t amount : { 10, 40, 50, 200 }) {
+        for(const char* tier : { "gold", "silver" }) {
+            liteexpr::SYMBOLS inputs = liteexpr::make_symbols({
+                { "amount" , liteexpr::make_value(amount) },
+                { "tier"   , liteexpr::make_value(tier) },
+                { "region" , liteexpr::make_value("EU") },
+                { "discount" , liteexpr::make_value(-0.125) },
+                { "threshold" , liteexpr::make_value(100) },
+                { "weights" , liteexpr::make_value({ { "gold", liteexpr::make_value(3) }, { "silver", liteexpr::make_value(2) } }) },
+            });
+
+            cout << amount << " " << tier << ": " << run(general, inputs) << " " << run(specialized, inputs) << endl;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,125 @@
+#include <string>
+#include <vector>
+#include <thread>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static void show(const liteexpr::Compiled& compiled) {
+    liteexpr::Caching caching = compiled.getCaching();
+
+    cout << "entries " << caching.entries << ", hits " << caching.hits << ", misses " << caching.misses
+        << ", evicted " << caching.evicted << ", expired " << caching.expired << endl;
+}
+
+
+static liteexpr::VALUE one(const vector<liteexpr::VALUE>& args) {
+    return liteexpr::make_value(1);
+}
+
+
+static liteexpr::VALUE two(const vector<liteexpr::VALUE>& args) {
+    return liteexpr::make_value(2);
+}
+
+
+static int counted = 0;
+
+static liteexpr::VALUE tally(const vector<liteexpr::VALUE>& args) {
+    return liteexpr::make_value(++counted);
+}
+
+
+static liteexpr::VALUE host(liteexpr::VALUE (*func)(const vector<liteexpr::VALUE>&), bool pure) {
+    liteexpr::FUNCTION fn(new liteexpr::Function(func, 1, 1));
+
+    fn->setPure(pure);
+
+    return fn;
+}
+
+
+static liteexpr::SYMBOLS order(int64_t total, const string& ccy, const string& note) {
+    return liteexpr::make_symbols({
+        { "order" , liteexpr::make_value({ { "total", liteexpr::make_value(total) }, { "ccy", liteexpr::make_value(ccy) }, { "note", liteexpr::make_value(note) } }) },
+        { "fx"    , liteexpr::make_value({ { "EUR", liteexpr::make_value(1.5) }, { "USD", liteexpr::make_value(1) } }) },
+        { "limit" , liteexpr::make_value(1000) },
+    });
+}
+
+
+int main(int argc, const char* argv[]) {
+    liteexpr::Compiled rule = liteexpr::compile("order.total * fx[order.ccy] > limit");
+
+    cout << "cached: " << rule.setCaching(100) << endl;
+
+    /* A member the rule doesn't read doesn't change the key */
+    cout << rule.eval(order(800, "EUR", "first"))->encoded() << endl;
+    cout << rule.eval(order(800, "EUR", "resent"))->encoded() << endl;
+    cout << rule.eval(order(800, "USD", "first"))->encoded() << endl;
+    cout << rule.eval(order(800, "EUR", "again"))->encoded() << endl;
+    show(rule);
+
+    /* Equal numbers of different types are different inputs */
+    liteexpr::Compiled half = liteexpr::compile("x / 2");
+
+    half.setCaching(10);
+    cout << half.eval(liteexpr::make_symbols({ { "x", liteexpr::make_value(1) } }))->encoded() << endl;
+    cout << half.eval(liteexpr::make_symbols({ { "x", liteexpr::make_value(1.0) } }))->encoded() << endl;
+    show(half);
+
+    /* Least recently used results make room */
+    liteexpr::Compiled square = liteexpr::compile("x * x");
+
+    square.setCaching(2);
+    for(int x : { 1, 2, 1, 3, 1, 2 }) {
+        cout << square.eval(liteexpr::make_symbols({ { "x", liteexpr::make_value(x) } }))->encoded() << " ";
+    }
+    cout << endl;
+    show(square);
+
+    /* Results expire */
+    liteexpr::Compiled aged = liteexpr::compile("SQRT(x)");
+
+    aged.setCaching(10, chrono::milliseconds(20));
+    aged.eval(liteexpr::make_symbols({ { "x", liteexpr::make_value(16) } }));
+    aged.eval(liteexpr::make_symbols({ { "x", liteexpr::make_value(16) } }));
+    this_thread::sleep_for(chrono::milliseconds(40));
+    aged.eval(liteexpr::make_symbols({ { "x", liteexpr::make_value(16) } }));
+    show(aged);
+
+    /* Arrays and objects aren't kept */
+    liteexpr::Compiled listed = liteexpr::compile("[x, x]");
+
+    listed.setCaching(10);
+    listed.eval(liteexpr::make_symbols({ { "x", liteexpr::make_value(1) } }));
+    listed.eval(liteexpr::make_symbols({ { "x", liteexpr::make_value(1) } }));
+    show(listed);
+
+    /* Which function is bound is part of the key */
+    liteexpr::Compiled rated = liteexpr::compile("rate(x) * 10");
+    liteexpr::SYMBOLS rates = liteexpr::make_symbols({ { "x", liteexpr::make_value(1) }, { "rate", host(one, true) } });
+
+    rated.setCaching(10);
+    cout << rated.eval(rates)->encoded() << " ";
+    rates->set("rate", host(two, true));
+    cout << rated.eval(rates)->encoded() << endl;
+
+    /* A built-in the host replaced is only trusted if its replacement is pure */
+    liteexpr::Compiled length = liteexpr::compile("LEN(x)");
+    liteexpr::SYMBOLS replaced = liteexpr::make_symbols({ { "x", liteexpr::make_value("abc") }, { "LEN", host(tally, false) } });
+
+    cout << "cached: " << length.setCaching(10) << endl;
+    cout << length.eval(replaced)->encoded() << " ";
+    cout << length.eval(replaced)->encoded() << endl;
+    show(length);
+
+    /* Programs that aren't pure can't be cached */
+    for(const char* source : { "PRINT(x)", "WHILE(0, x)", "n = x; n * 2", "x++", "EVAL(\"x\")", "IF(x, ROUND(x), LEN(y))" }) {
+        cout << source << ": " << liteexpr::compile(source).setCaching(10) << endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,112 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static int calls = 0;
+
+static liteexpr::VALUE twice(const vector<liteexpr::VALUE>& args) {
+    calls++;
+
+    return args[0]->op_mul(liteexpr::make_value(2));
+}
+
+
+static liteexpr::VALUE doubler(bool pure) {
+    liteexpr::FUNCTION fn(new liteexpr::Function(twice, 1, 1));
+
+    fn->setPure(pure);
+
+    return fn;
+}
+
+
+static void run(liteexpr::SYMBOLS symbols, const string& expr) {
+    try {
+        liteexpr::eval(expr, symbols);
+    }
+    catch(const liteexpr::Error& e) {
+        cout << "error: " << string(e) << endl;
+    }
+}
+
+
+static void show(const liteexpr::Compiled& compiled) {
+    liteexpr::Caching caching = compiled.getCaching();
+
+    cout << "calls " << calls << ", hits " << caching.hits << ", misses " << caching.misses << endl;
+}
+
+
+int main(int argc, const char* argv[]) {
+    /* A program that calls pure host functions can cache its results */
+    liteexpr::Compiled rule = liteexpr::compile("double(x) + 1");
+
+    liteexpr::VALUE pure = doubler(true);
+
+    cout << "cached: " << rule.setCaching(10) << endl;
+
+    for(int x : { 1, 2, 1, 1 }) {
+        cout << rule.eval(liteexpr::make_symbols({ { "x", liteexpr::make_value(x) }, { "double", pure } }))->encoded() << " ";
+    }
+    cout << endl;
+    show(rule);
+
+    /* ...but not when the function it finds isn't pure */
+    calls = 0;
+    for(int x : { 1, 1 }) {
+        cout << rule.eval(liteexpr::make_symbols({ { "x", liteexpr::make_value(x) }, { "double", doubler(false) } }))->encoded() << " ";
+    }
+    cout << endl;
+    show(rule);
+
+    /* Calls to pure constant functions are folded into a specialized program */
+    liteexpr::SYMBOLS constants = liteexpr::make_symbols({
+        { "rate"   , liteexpr::make_value(1.25) },
+        { "double" , doubler(true) },
+        { "noisy"  , doubler(false) },
+    });
+
+    cout << liteexpr::compile("amount * double(rate)", constants).getSource() << endl;
+    cout << liteexpr::compile("amount * noisy(rate)", constants).getSource() << endl;
+
+    /* MEMO() wraps host functions too, and keeps their purity */
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({ { "double", doubler(true) } });
+
+    calls = 0;
+    cout << liteexpr::eval("fast = MEMO(double); fast(3) + fast(3) + fast(4)", symbols)->encoded() << endl;
+    cout << "calls " << calls << ", pure " << dynamic_pointer_cast<liteexpr::Function>(symbols->find("fast"))->isPure() << endl;
+
+    /* MEMO() of a closure remembers what it returned for each list of arguments */
+    run(symbols,
+        "calls = 0;"
+        "fib = MEMO(FUNCTION(\"?\", calls = calls + 1; IF(ARG[0] < 2, ARG[0], fib(ARG[0]-1) + fib(ARG[0]-2))));"
+        "PRINT(fib(80), calls);"
+        "PRINT(fib(80), fib(40), calls)");
+
+    /* Arguments are remembered by value, up to the capacity given */
+    run(symbols,
+        "depth = MEMO(FUNCTION(\"?\", IF(LEN(ARG[0].kids) == 0, 1, 1 + depth(ARG[0].kids[0]))), 16);"
+        "leaf = { kids: [] };"
+        "tree = { kids: [{ kids: [leaf] }, leaf] };"
+        "PRINT(depth(tree), depth({ kids: [{ kids: [{ kids: [] }] }] }))");
+
+    run(symbols, "sq = MEMO(FUNCTION(\"?\", ARG[0] * ARG[0]), 2); PRINT(sq(2), sq(2.0), sq(3), sq(2))");
+
+    /* Only the arguments are compared, so other variables the function reads
+    * are as they were when the result was remembered */
+    run(symbols,
+        "k = 1;"
+        "f = MEMO(FUNCTION(\"?\", PRINT(\"computing\"); ARG[0] + k));"
+        "PRINT(f(1));"
+        "k = 10;"
+        "PRINT(f(1))");
+
+    /* Built-ins that take expressions can't be memoized */
+    run(symbols, "MEMO(IF)");
+
+    return 0;
+}
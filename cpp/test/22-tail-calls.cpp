@@ -0,0 +1,40 @@
+#include <string>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static void run(const string& expr) {
+    try {
+        liteexpr::eval(expr, liteexpr::make_symbols({}));
+    }
+    catch(const liteexpr::Error& e) {
+        cout << "error: " << string(e) << endl;
+    }
+}
+
+
+int main(int argc, const char* argv[]) {
+    /* A branch of IF() */
+    run("count = FUNCTION(\"??\", IF(ARG[0] == 0, ARG[1], count(ARG[0]-1, ARG[1]+1)));"
+        "PRINT(count(100000, 0))");
+
+    /* A branch of ?:, between two functions */
+    run("even = FUNCTION(\"?\", ARG[0] == 0 ? 1 : odd(ARG[0]-1));"
+        "odd  = FUNCTION(\"?\", ARG[0] == 0 ? 0 : even(ARG[0]-1));"
+        "PRINT(even(100001), odd(100001))");
+
+    /* The last expression of a sequence */
+    run("sum = FUNCTION(\"??\", n = ARG[0]; acc = ARG[1]; (n == 0) ? acc : sum(n-1, acc+n));"
+        "PRINT(sum(50000, 0))");
+
+    /* Variables are passed by reference, as they are to other calls */
+    run("f = FUNCTION(\"?\", x = 99; ARG[0]);"
+        "x = 1;"
+        "g = FUNCTION(\"\", f(x));"
+        "h = FUNCTION(\"\", y = f(x); y);"
+        "PRINT(g(), h())");
+
+    return 0;
+}
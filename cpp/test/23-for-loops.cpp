@@ -0,0 +1,63 @@
+#include <string>
+#include <vector>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static liteexpr::VALUE three(const vector<liteexpr::VALUE>& args) {
+    return liteexpr::make_value(3);
+}
+
+
+static void run(liteexpr::SYMBOLS symbols, const string& expr, const liteexpr::Limits& limits=liteexpr::Limits()) {
+    try {
+        liteexpr::eval(expr, symbols, limits);
+    }
+    catch(const liteexpr::Error& e) {
+        cout << "error: " << string(e) << endl;
+    }
+}
+
+
+static void run(const string& expr) {
+    run(liteexpr::make_symbols({}), expr);
+}
+
+
+int main(int argc, const char* argv[]) {
+    /* A body that doesn't see the counter, which is written back at the end */
+    run("n = 0; FOR(i = 0, i < 100000, i++, n += 2); PRINT(n, i)");
+    run("a = [1, 2, 3, 4]; n = 0; FOR(i = 0, i <= LEN(a), i++, n += 1); PRINT(n, i)");
+    run("n = 0; FOR(i = 0, i < 10.5, i++, n++); PRINT(n, i)");
+
+    /* A body that reads the counter */
+    run("s = \"\"; FOR(i = 0, i < 5, i++, s += i); PRINT(s, i)");
+
+    /* A counter that changes type mid-loop continues on the generic path, and
+    * fails as `i++` does */
+    run("FOR(i = 0, i < 5, i++, PRINT(i); IF(i == 2, i = 2.5))");
+    run("FOR(i = 0, i < 3, i++, IF(i == 1, i = \"x\"); PRINT(i))");
+
+    /* A Double counter can't be incremented */
+    run("n = 0; FOR(i = 0.5, i < 3, i++, n++); PRINT(n, i)");
+
+    /* LEN() the host replaced is called as any other function */
+    liteexpr::SYMBOLS symbols = liteexpr::make_symbols({
+        { "LEN", liteexpr::VALUE(new liteexpr::Function(three, 1, 1)) },
+    });
+
+    run(symbols, "a = [1, 2, 3, 4, 5]; n = 0; FOR(i = 0, i < LEN(a), i++, n++); PRINT(n, i)");
+
+    /* A counter at the largest integer wraps as i++ does; the counter so far
+    * is written back when the loop is interrupted */
+    liteexpr::Limits limits;
+
+    limits.steps = 20;
+    symbols = liteexpr::make_symbols({});
+    run(symbols, "n = 0; FOR(i = 9223372036854775805, i <= 9223372036854775807, i++, n++)", limits);
+    cout << symbols->find("n")->encoded() << " " << symbols->find("i")->encoded() << endl;
+
+    return 0;
+}
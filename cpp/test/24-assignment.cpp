@@ -0,0 +1,29 @@
+#include <string>
+#include <iostream>
+#include "liteexpr.h"
+
+using namespace std;
+
+
+static void run(const string& expr) {
+    try {
+        liteexpr::eval(expr, liteexpr::make_symbols({}));
+    }
+    catch(const liteexpr::Error& e) {
+        cout << "error: " << string(e) << endl;
+    }
+}
+
+
+int main(int argc, const char* argv[]) {
+    /* Elements can be replaced, and one appended at the end */
+    run("a = [1, 2, 3]; a[0] = 10; a[2] = 30; a[3] = 4; PRINT(a[0], a[1], a[2], a[3], LEN(a))");
+    run("a = [1, 2, 3]; a[5] = 6");
+    run("a = [1, 2, 3]; a[-1] = 0");
+
+    /* ||= and &&= keep the value, not a reference to the variable */
+    run("o = { x: 1, y: 0 }; o.x ||= 2; o.y ||= 3; PRINT(o.x, o.y)");
+    run("o = { x: 1, y: 0 }; o.x &&= 2; o.y &&= 3; PRINT(o.x, o.y)");
+
+    return 0;
+}
@@ -26,11 +26,15 @@ const std::string readfile(const char* filename) {
     return data;
 }
 
-const std::string feval(const char* filename, std::shared_ptr<liteexpr::SymbolTable> symbols) {
-    std::string data = readfile(filename);
+bool iscompiled(const std::string& filename) {
+    return filename.size() > 4 && filename.compare(filename.size() - 4, 4, ".lec") == 0;
+}
 
+const std::string feval(const char* filename, std::shared_ptr<liteexpr::SymbolTable> symbols) {
     try {
-        return liteexpr::eval(data, symbols)->svalue();
+        if(iscompiled(filename)) return liteexpr::load_compiled(filename).eval(symbols)->svalue();
+
+        return liteexpr::eval(readfile(filename), symbols)->svalue();
     }
     catch(liteexpr::Error e) {
         std::cerr << std::string(e) << std::endl;
@@ -39,10 +43,31 @@ const std::string feval(const char* filename, std::shared_ptr<liteexpr::SymbolTa
     return std::string();
 }
 
+/* Write filename.le to filename.lec */
+void fcompile(const char* filename) {
+    std::string data = readfile(filename);
+    std::string output(filename);
+
+    output += (output.size() > 3 && output.compare(output.size() - 3, 3, ".le") == 0) ? "c" : ".lec";
+
+    try {
+        liteexpr::compile(data).save(output);
+    }
+    catch(liteexpr::Error e) {
+        std::cerr << std::string(e) << std::endl;
+    }
+}
+
 int main(int argc, const char* argv[]) {
     liteexpr::SYMBOLS symbols(new liteexpr::SymbolTable());
     const char** cp = argv;
 
+    if(argv[1] && std::string(argv[1]) == "-c") {
+        for(cp++; *++cp;) fcompile(*cp);
+
+        return 0;
+    }
+
     while(*++cp) {
         feval(*cp, symbols);
     }